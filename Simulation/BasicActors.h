@@ -79,14 +79,12 @@ namespace PhysicsEngine
 		//mesh cooking (preparation)
 		PxConvexMesh* CookMesh(const PxConvexMeshDesc& mesh_desc)
 		{
-			PxDefaultMemoryOutputStream stream;
+			PxConvexMesh* mesh = CookConvexMesh(mesh_desc);
 
-			if(!GetCooking()->cookConvexMesh(mesh_desc, stream))
+			if(!mesh)
 				throw new Exception("ConvexMesh::CookMesh, cooking failed.");
 
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
-
-			return GetPhysics()->createConvexMesh(input);
+			return mesh;
 		}
 	};
 
@@ -112,14 +110,12 @@ namespace PhysicsEngine
 		//mesh cooking (preparation)
 		PxTriangleMesh* CookMesh(const PxTriangleMeshDesc& mesh_desc)
 		{
-			PxDefaultMemoryOutputStream stream;
+			PxTriangleMesh* mesh = CookTriangleMesh(mesh_desc);
 
-			if(!GetCooking()->cookTriangleMesh(mesh_desc, stream))
+			if(!mesh)
 				throw new Exception("TriangleMesh::CookMesh, cooking failed.");
 
-			PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
-
-			return GetPhysics()->createTriangleMesh(input);
+			return mesh;
 		}
 	};
 
@@ -385,9 +381,16 @@ namespace PhysicsEngine
 			data->unlock();
 		}
 
+		virtual void Rebind(PxActor* new_actor)
+		{
+			Actor::Rebind(new_actor);
+			cloth = actor ? actor->is<PxCloth>() : 0;
+		}
+
 		~Cloth()
 		{
-			delete (UserData*)actor->userData;
+			if (actor)
+				delete (UserData*)actor->userData;
 		}
 	};
 
@@ -0,0 +1,304 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+
+namespace Benchmark
+{
+	using namespace physx;
+	using namespace std;
+
+	//steps excluded from the timings (scene settling, first contacts)
+	const PxU32 warmup_steps = 30;
+
+	//time the given number of calls to step after the warm-up ones
+	template<class Step>
+	static StepTimes TimeSteps(PxU32 steps, Step step)
+	{
+		for (PxU32 i = 0; i < warmup_steps; i++)
+			step();
+
+		StepTimes times = { steps, 0., 1e9, 0. };
+		for (PxU32 i = 0; i < steps; i++)
+		{
+			chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+			step();
+			double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+			times.mean += ms;
+			times.min = min(times.min, ms);
+			times.max = max(times.max, ms);
+		}
+		if (steps)
+			times.mean /= steps;
+		return times;
+	}
+
+	StepTimes RunScene(const PhysicsEngine::SceneConfig& config, PxU32 steps, PxReal dt)
+	{
+		PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(config);
+		scene->Init();
+
+		StepTimes times = TimeSteps(steps, [&]() { scene->Update(dt); });
+
+		delete scene;
+		return times;
+	}
+
+	void Threads(PxU32 steps, PxReal dt)
+	{
+		PxU32 auto_threads = PhysicsEngine::WorkerThreads(PhysicsEngine::SceneConfig());
+
+		vector<PxU32> counts = { 1, 2, 4, 8, auto_threads };
+		sort(counts.begin(), counts.end());
+		counts.erase(unique(counts.begin(), counts.end()), counts.end());
+
+		printf("Step time, Cabin + Tree scene, %u steps of %.4fs (auto = %u threads)\n", steps, dt, auto_threads);
+		printf("%8s %10s %10s %10s %9s\n", "threads", "mean(ms)", "min(ms)", "max(ms)", "speedup");
+
+		double baseline = 0.;
+		for (PxU32 threads : counts)
+		{
+			StepTimes times = RunScene(PhysicsEngine::SceneConfig(threads), steps, dt);
+			if (!baseline)
+				baseline = times.mean;
+
+			printf("%8u %10.3f %10.3f %10.3f %8.2fx\n", threads, times.mean, times.min, times.max,
+				times.mean > 0. ? baseline / times.mean : 0.);
+		}
+	}
+
+	//release the PhysX actor owned by a wrapper (the wrapper destructor only frees the user data)
+	static void Release(PhysicsEngine::Actor* wrapper)
+	{
+		PxActor* actor = wrapper->Get();
+		delete wrapper;
+		actor->release();
+	}
+
+	//an actor with the given number of log shapes stacked in layers like the cabin walls,
+	//boxes are used so that the timing is not dominated by convex mesh cooking
+	static PhysicsEngine::DynamicActor* LogPile(PxU32 shapes)
+	{
+		PhysicsEngine::DynamicActor* pile = new PhysicsEngine::DynamicActor(PxTransform(PxIdentity));
+		for (PxU32 i = 0; i < shapes; i++)
+		{
+			pile->CreateShape(PxBoxGeometry(1.5f, .1f, .1f), 300.f);
+			PxQuat rotation = (i & 1) ? PxQuat(PxPi / 2, PxVec3(0, 1, 0)) : PxQuat(PxIdentity);
+			pile->GetShape(i)->setLocalPose(PxTransform(PxVec3(0.f, (i / 2) * .2f, 0.f), rotation));
+			pile->Color(PxVec3(.6f, .35f, .16f), i);
+		}
+		return pile;
+	}
+
+	void Shapes(PxU32 repeats)
+	{
+		printf("Actor construction, %u repeats\n", repeats);
+		printf("%-24s %8s %10s %10s %10s\n", "actor", "shapes", "mean(ms)", "min(ms)", "us/shape");
+
+		for (PxU32 test = 0; test < 3; test++)
+		{
+			const char* name = 0;
+			PxU32 shapes = 0;
+			double total = 0., best = 1e9;
+
+			for (PxU32 i = 0; i < repeats; i++)
+			{
+				chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+
+				PhysicsEngine::DynamicActor* actor;
+				PhysicsEngine::Actor* extra = 0;
+				if (test == 0)
+				{
+					PhysicsEngine::Cabin* cabin = new PhysicsEngine::Cabin(PxTransform(PxVec3(0.f, 10.f, 0.f)));
+					extra = cabin->floor;
+					actor = cabin;
+					name = "Cabin";
+				}
+				else
+				{
+					actor = LogPile(test == 1 ? 66 : 1000);
+					name = "log pile (boxes)";
+				}
+				actor->UpdateMass();
+
+				double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+				total += ms;
+				best = min(best, ms);
+
+				shapes = (PxU32)actor->GetShapes().size();
+				Release(actor);
+				if (extra)
+					Release(extra);
+			}
+
+			double mean = repeats ? total / repeats : 0.;
+			printf("%-24s %8u %10.3f %10.3f %10.3f\n", name, shapes, mean, best, shapes ? 1000. * mean / shapes : 0.);
+		}
+	}
+
+	//create and initialise the demo scene with an empty in-process mesh cache
+	static double SceneStartup(const PhysicsEngine::SceneConfig& config)
+	{
+		PhysicsEngine::RC_Cylinder::ReleaseCache();
+
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+		PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(config);
+		scene->Init();
+		double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+
+		delete scene;
+		return ms;
+	}
+
+	void Startup(const PhysicsEngine::SceneConfig& config)
+	{
+		printf("Scene startup, Cabin + Tree scene\n");
+		printf("%8s %10s %8s %8s\n", "pack", "init(ms)", "cooked", "loaded");
+
+		//cold: no pack, every mesh is cooked and then written to the pack
+		PhysicsEngine::SaveMeshPack();
+		PhysicsEngine::CloseMeshPack();
+		PhysicsEngine::MeshPackFile("meshes.bench.pack");
+		remove("meshes.bench.pack");
+		PhysicsEngine::OpenMeshPack();
+
+		double cold = SceneStartup(config);
+		PhysicsEngine::MeshPackStats stats = PhysicsEngine::GetMeshPackStats();
+		printf("%8s %10.3f %8u %8u\n", "cold", cold, stats.cooked, stats.loaded);
+		PhysicsEngine::SaveMeshPack();
+
+		//warm: the meshes are created from the mapped pack
+		PhysicsEngine::OpenMeshPack();
+		double warm = SceneStartup(config);
+		stats = PhysicsEngine::GetMeshPackStats();
+		printf("%8s %10.3f %8u %8u\n", "warm", warm, stats.cooked, stats.loaded);
+
+		PhysicsEngine::CloseMeshPack();
+		remove("meshes.bench.pack");
+		PhysicsEngine::MeshPackFile("");
+	}
+
+	void Particles(PxU32 particles, PxU32 steps, PxReal dt)
+	{
+		PhysicsEngine::ParticleCloud cloud(particles);
+
+		//a pile of sawdust sprayed around a tree trunk, a player and a cabin
+		cloud.AddBox(PxBounds3(PxVec3(-.3f, 0.f, -.3f), PxVec3(.3f, 4.f, .3f)));
+		cloud.AddBox(PxBounds3(PxVec3(-2.5f, 0.f, -.5f), PxVec3(-1.5f, 1.75f, .5f)));
+		for (PxU32 i = 0; i < 4; i++)
+			cloud.AddBox(PxBounds3(PxVec3(2.f + i * .5f, 0.f, -2.f), PxVec3(2.2f + i * .5f, 1.f, 2.f)));
+		cloud.AddSphere(PxVec3(0.f, 1.f, 1.f), .3f);
+		cloud.AddSphere(PxVec3(1.f, .5f, -1.f), .3f);
+
+		srand(1);
+		for (PxU32 i = 0; i < particles; i++)
+		{
+			PxReal angle = (float(rand()) / RAND_MAX) * PxTwoPi;
+			PxReal speed = 1.f + 4.f * float(rand()) / RAND_MAX;
+			PxVec3 velocity(cosf(angle), 1.f + float(rand()) / RAND_MAX, sinf(angle));
+			cloud.Emit(PxVec3(0.f, 1.f, .5f), velocity * speed, PX_MAX_F32);
+		}
+
+		StepTimes times = TimeSteps(steps, [&]() { cloud.Step(dt); });
+
+		printf("Particle cloud step time, %u particles (%u-wide SIMD), %u steps of %.4fs\n",
+			cloud.Count(), PhysicsEngine::ParticleCloud::SimdWidth(), steps, dt);
+		printf("%10s %10s %10s\n", "mean(ms)", "min(ms)", "max(ms)");
+		printf("%10.3f %10.3f %10.3f\n", times.mean, times.min, times.max);
+	}
+
+	//sawdust on a grid above the ground, a trunk and a wall, emitted at once and never expiring
+	class ParticleScene : public PhysicsEngine::Scene
+	{
+		PhysicsEngine::ParticleBackend backend;
+		PxU32 particles;
+		PhysicsEngine::Emitter* emitter;
+
+	public:
+		ParticleScene(PhysicsEngine::ParticleBackend _backend, PxU32 _particles, const PhysicsEngine::SceneConfig& config)
+			: Scene(PxDefaultSimulationFilterShader, config), backend(_backend), particles(_particles), emitter(0)
+		{
+		}
+
+		~ParticleScene()
+		{
+			Sync();
+			if (emitter)
+				Release(emitter);
+		}
+
+		virtual void CustomInit()
+		{
+			Add(new PhysicsEngine::Plane());
+
+			PhysicsEngine::StaticActor* trunk = new PhysicsEngine::StaticActor(PxTransform(PxVec3(0.f, 2.f, 0.f)));
+			trunk->CreateShape(PxBoxGeometry(.3f, 2.f, .3f));
+			Add(trunk);
+			PhysicsEngine::StaticActor* wall = new PhysicsEngine::StaticActor(PxTransform(PxVec3(3.f, 1.f, 0.f)));
+			wall->CreateShape(PxBoxGeometry(.1f, 1.f, 3.f));
+			Add(wall);
+
+			emitter = new PhysicsEngine::Emitter(PxTransform(PxVec3(0.f, 1.f, 0.f)), 0.f, 0.f, particles, backend);
+			emitter->ParticleLifetime(1 << 30);
+			emitter->AddCollider(trunk);
+			emitter->AddCollider(wall);
+			Add(emitter);
+
+			//the emitter is moved to each grid point, a zero rate and speed emit the particles at rest
+			PxU32 side = (PxU32)ceilf(powf((PxReal)particles, 1.f / 3.f));
+			const PxReal spacing = .12f;
+			for (PxU32 i = 0; i < particles; i++)
+			{
+				PxVec3 position(((i % side) - side * .5f) * spacing, .5f + (i / (side * side)) * spacing,
+					(((i / side) % side) - side * .5f) * spacing);
+				emitter->Get()->is<PxRigidDynamic>()->setGlobalPose(PxTransform(position));
+				emitter->emit();
+			}
+		}
+
+		virtual void CustomUpdate(PxReal dt)
+		{
+			emitter->Update(dt);
+
+			for (PhysicsEngine::Particle* part : emitter->getParticles())
+			{
+				if (!part->inScene)
+				{
+					Add(part);
+					part->inScene = true;
+				}
+			}
+			for (PhysicsEngine::Particle* part : emitter->getDeadParticles())
+				Remove(part);
+			emitter->ClearDeadParticles();
+		}
+
+		PxU32 LiveParticles() { return emitter->Stats().active; }
+	};
+
+	void ParticleBackends(const PhysicsEngine::SceneConfig& config, PxU32 steps, PxReal dt)
+	{
+		const PxU32 counts[] = { 500, 5000, 50000 };
+		const PhysicsEngine::ParticleBackend backends[] = { PhysicsEngine::RIGID_PARTICLES, PhysicsEngine::CLOUD_PARTICLES, PhysicsEngine::PHYSX_PARTICLES };
+		const char* names[] = { "rigid", "cloud", "physx" };
+
+		printf("Sawdust step time per backend, %u steps of %.4fs (%u worker threads)\n", steps, dt, PhysicsEngine::WorkerThreads(config));
+		printf("%10s %8s %8s %10s %10s %10s\n", "particles", "backend", "live", "mean(ms)", "min(ms)", "max(ms)");
+
+		for (PxU32 count : counts)
+		{
+			for (PxU32 b = 0; b < 3; b++)
+			{
+				ParticleScene* scene = new ParticleScene(backends[b], count, config);
+				scene->Init();
+
+				StepTimes times = TimeSteps(steps, [&]() { scene->Update(dt); });
+
+				printf("%10u %8s %8u %10.3f %10.3f %10.3f\n", count, names[b], scene->LiveParticles(), times.mean, times.min, times.max);
+				delete scene;
+			}
+		}
+	}
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include "MyPhysicsEngine.h"
+
+namespace Benchmark
+{
+	using namespace physx;
+
+	///Step time statistics for a single benchmark run
+	struct StepTimes
+	{
+		PxU32 steps;
+		double mean, min, max; //in milliseconds
+	};
+
+	///Step the demo scene (Cabin + Tree) with the given dispatcher options
+	StepTimes RunScene(const PhysicsEngine::SceneConfig& config, PxU32 steps=600, PxReal dt=1.f/90.f);
+
+	///Print step times for 1/2/4/8/N worker threads (N - auto-detected)
+	void Threads(PxU32 steps=600, PxReal dt=1.f/90.f);
+
+	///Print the construction time of a Cabin (66 shapes) and of a 1000 shape log pile,
+	///including the mass update done when an actor is added to a scene
+	void Shapes(PxU32 repeats=20);
+
+	///Print the step time of a sawdust particle cloud (no PhysX actors, a single thread)
+	void Particles(PxU32 particles=100000, PxU32 steps=600, PxReal dt=1.f/90.f);
+
+	///Print the step time of a scene with 500, 5k and 50k sawdust particles for the rigid, cloud and PhysX particle backends
+	void ParticleBackends(const PhysicsEngine::SceneConfig& config=PhysicsEngine::SceneConfig(), PxU32 steps=300, PxReal dt=1.f/90.f);
+
+	///Print the scene startup time with all meshes cooked (cold) and loaded from the mesh pack (warm)
+	void Startup(const PhysicsEngine::SceneConfig& config=PhysicsEngine::SceneConfig());
+}
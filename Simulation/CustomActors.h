@@ -5,6 +5,7 @@
 #include "RC_Cylinder.h"
 #include <iomanip>
 #include <random>
+#include <stdexcept>
 
 namespace PhysicsEngine {
     class Character : public DynamicActor {
@@ -73,7 +74,7 @@ namespace PhysicsEngine {
             );
         }
 
-        void updatePosition(PxVec3& delta, PxQuat& rot)
+        void updatePosition(const PxVec3& delta, const PxQuat& rot)
         {
             PxReal headSize = m_height / 8.0f;              
             PxReal torsoHeight = headSize * 3.0f;        
@@ -107,15 +108,14 @@ namespace PhysicsEngine {
     public:
         DynamicTreePart(PxTransform pose = PxTransform(PxIdentity), PxReal baseRadius = 2.f, PxReal topRadius = 1.f, PxReal height = 1.f)
             : DynamicActor(pose),
-            m_verts(GenerateTaperedCylinderVertices(baseRadius, topRadius, height, 16))
+            m_convexMesh(RC_Cylinder::ConvexCylinder(baseRadius, height / 2, 16, topRadius / baseRadius))
         {
-            PxConvexMesh* convexMesh = CreateConvexMesh(m_verts);
-            if (!convexMesh) throw std::runtime_error("Convex mesh creation failed.");
+            if (!m_convexMesh) throw std::runtime_error("Convex mesh creation failed.");
 
             /*
                 600 Kg/m^2
             */
-            CreateShape(PxConvexMeshGeometry(convexMesh), 600.0f);
+            CreateShape(PxConvexMeshGeometry(m_convexMesh), 600.0f);
             GetShape(0)->setLocalPose(pose);
         }
 
@@ -125,57 +125,7 @@ namespace PhysicsEngine {
         }
 
     private:
-        PxConvexMesh* m_convexMesh = nullptr;
-        std::vector<PxVec3> m_verts;
-
-        std::vector<PxVec3> GenerateTaperedCylinderVertices(PxReal baseRadius, PxReal topRadius, PxReal height, int numSides)
-        {
-            std::vector<PxVec3> verts;
-            float angleStep = PxTwoPi / numSides;
-            float halfHeight = height / 2;
-
-            for (int i = 0; i < numSides; i++)
-            {
-                float angle = i * angleStep;
-                float x = baseRadius * cos(angle);
-                float z = baseRadius * sin(angle);
-                verts.push_back(PxVec3(x, -halfHeight, z));
-            }
-
-            for (int i = 0; i < numSides; i++)
-            {
-                float angle = i * angleStep;
-                float x = topRadius * cos(angle);
-                float z = topRadius * sin(angle);
-                verts.push_back(PxVec3(x, halfHeight, z));
-            }
-
-            verts.push_back(PxVec3(0, -halfHeight, 0));
-            verts.push_back(PxVec3(0, halfHeight, 0));
-
-            return verts;
-        }
-
-        PxConvexMesh* CreateConvexMesh(const std::vector<PxVec3>& vertices)
-        {
-            PxConvexMeshDesc convexDesc;
-
-            if (vertices.size() > std::numeric_limits<PxU32>::max()) {
-                return nullptr;
-            }
-
-            convexDesc.points.count = static_cast<PxU32>(vertices.size());
-            convexDesc.points.stride = sizeof(PxVec3);
-            convexDesc.points.data = vertices.data();
-            convexDesc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
-
-            PxDefaultMemoryOutputStream buf;
-            if (!GetCooking()->cookConvexMesh(convexDesc, buf))
-                return nullptr;
-
-            PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
-            return GetPhysics()->createConvexMesh(input);
-        }
+        PxConvexMesh* m_convexMesh;
     };
 
     class Tree : public DynamicActor
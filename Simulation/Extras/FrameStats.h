@@ -0,0 +1,75 @@
+#pragma once
+
+#include <vector>
+
+namespace VisualDebugger
+{
+	using namespace std;
+
+	///Rolling timings of a number of frame stages over the last frames (in seconds)
+	class FrameStats
+	{
+		//samples[stage][frame], a ring buffer over the frames
+		vector<vector<double> > samples;
+		unsigned int current;
+		unsigned int count;
+
+	public:
+		FrameStats(unsigned int stages, unsigned int frames=240) :
+			samples(stages, vector<double>(frames, 0.)), current(0), count(0)
+		{
+		}
+
+		///Set the time of a stage in the current frame
+		void Set(unsigned int stage, double seconds)
+		{
+			samples[stage][current] = seconds;
+		}
+
+		///Close the current frame, the oldest one is overwritten by the next
+		void NextFrame()
+		{
+			current = (current + 1) % samples[0].size();
+			if (count < samples[0].size())
+				count++;
+			for (unsigned int i = 0; i < samples.size(); i++)
+				samples[i][current] = 0.;
+		}
+
+		///Number of closed frames (up to the window size)
+		unsigned int Frames()
+		{
+			return count;
+		}
+
+		///Average time of a stage over the closed frames
+		double Average(unsigned int stage)
+		{
+			double sum = 0.;
+			for (unsigned int i = 1; i <= count; i++)
+				sum += samples[stage][(current + samples[stage].size() - i) % samples[stage].size()];
+			return count ? sum / count : 0.;
+		}
+
+		///Longest time of a stage over the closed frames
+		double Max(unsigned int stage)
+		{
+			double max = 0.;
+			for (unsigned int i = 1; i <= count; i++)
+			{
+				double value = samples[stage][(current + samples[stage].size() - i) % samples[stage].size()];
+				if (value > max)
+					max = value;
+			}
+			return max;
+		}
+
+		///Times of a stage over the closed frames from the oldest to the newest (in milliseconds)
+		void History(unsigned int stage, vector<float>& values)
+		{
+			values.resize(count);
+			for (unsigned int i = 0; i < count; i++)
+				values[i] = (float)(1000. * samples[stage][(current + samples[stage].size() - count + i) % samples[stage].size()]);
+		}
+	};
+}
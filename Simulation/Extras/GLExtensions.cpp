@@ -0,0 +1,155 @@
+#include "GLExtensions.h"
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <GL/glx.h>
+#endif
+
+namespace VisualDebugger
+{
+	namespace GLExt
+	{
+		void (APIENTRY *GenBuffers)(GLsizei n, GLuint* buffers) = 0;
+		void (APIENTRY *DeleteBuffers)(GLsizei n, const GLuint* buffers) = 0;
+		void (APIENTRY *BindBuffer)(GLenum target, GLuint buffer) = 0;
+		void (APIENTRY *BufferData)(GLenum target, GLsizeiptr size, const void* data, GLenum usage) = 0;
+		void (APIENTRY *BufferSubData)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data) = 0;
+		void (APIENTRY *PointParameterf)(GLenum pname, GLfloat param) = 0;
+		void (APIENTRY *PointParameterfv)(GLenum pname, const GLfloat* params) = 0;
+		GLuint (APIENTRY *CreateShader)(GLenum type) = 0;
+		void (APIENTRY *DeleteShader)(GLuint shader) = 0;
+		void (APIENTRY *ShaderSource)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) = 0;
+		void (APIENTRY *CompileShader)(GLuint shader) = 0;
+		void (APIENTRY *GetShaderiv)(GLuint shader, GLenum pname, GLint* params) = 0;
+		void (APIENTRY *GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, GLchar* log) = 0;
+		GLuint (APIENTRY *CreateProgram)() = 0;
+		void (APIENTRY *DeleteProgram)(GLuint program) = 0;
+		void (APIENTRY *AttachShader)(GLuint program, GLuint shader) = 0;
+		void (APIENTRY *LinkProgram)(GLuint program) = 0;
+		void (APIENTRY *GetProgramiv)(GLuint program, GLenum pname, GLint* params) = 0;
+		void (APIENTRY *UseProgram)(GLuint program) = 0;
+		void (APIENTRY *BindAttribLocation)(GLuint program, GLuint index, const GLchar* name) = 0;
+		GLint (APIENTRY *GetAttribLocation)(GLuint program, const GLchar* name) = 0;
+		GLint (APIENTRY *GetUniformLocation)(GLuint program, const GLchar* name) = 0;
+		void (APIENTRY *Uniform1i)(GLint location, GLint value) = 0;
+		void (APIENTRY *EnableVertexAttribArray)(GLuint index) = 0;
+		void (APIENTRY *DisableVertexAttribArray)(GLuint index) = 0;
+		void (APIENTRY *VertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer) = 0;
+		void (APIENTRY *VertexAttribDivisor)(GLuint index, GLuint divisor) = 0;
+		void (APIENTRY *DrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances) = 0;
+		void (APIENTRY *GenVertexArrays)(GLsizei n, GLuint* arrays) = 0;
+		void (APIENTRY *DeleteVertexArrays)(GLsizei n, const GLuint* arrays) = 0;
+		void (APIENTRY *BindVertexArray)(GLuint array) = 0;
+		GLuint (APIENTRY *GetUniformBlockIndex)(GLuint program, const GLchar* name) = 0;
+		void (APIENTRY *UniformBlockBinding)(GLuint program, GLuint index, GLuint binding) = 0;
+		void (APIENTRY *BindBufferBase)(GLenum target, GLuint index, GLuint buffer) = 0;
+		void (APIENTRY *TexBuffer)(GLenum target, GLenum format, GLuint buffer) = 0;
+		void (APIENTRY *ActiveTexture)(GLenum texture) = 0;
+
+		//the core name first, then the ARB extension name
+		template<class T> static void LoadFunction(T& function, const char* name, const char* arb_name)
+		{
+#ifdef _WIN32
+			function = (T)wglGetProcAddress(name);
+			if (!function)
+				function = (T)wglGetProcAddress(arb_name);
+#else
+			function = (T)glXGetProcAddressARB((const GLubyte*)name);
+			if (!function)
+				function = (T)glXGetProcAddressARB((const GLubyte*)arb_name);
+#endif
+		}
+
+		void Load()
+		{
+			LoadFunction(GenBuffers, "glGenBuffers", "glGenBuffersARB");
+			LoadFunction(DeleteBuffers, "glDeleteBuffers", "glDeleteBuffersARB");
+			LoadFunction(BindBuffer, "glBindBuffer", "glBindBufferARB");
+			LoadFunction(BufferData, "glBufferData", "glBufferDataARB");
+			LoadFunction(BufferSubData, "glBufferSubData", "glBufferSubDataARB");
+			LoadFunction(PointParameterf, "glPointParameterf", "glPointParameterfARB");
+			LoadFunction(PointParameterfv, "glPointParameterfv", "glPointParameterfvARB");
+			LoadFunction(CreateShader, "glCreateShader", "glCreateShaderObjectARB");
+			LoadFunction(DeleteShader, "glDeleteShader", "glDeleteObjectARB");
+			LoadFunction(ShaderSource, "glShaderSource", "glShaderSourceARB");
+			LoadFunction(CompileShader, "glCompileShader", "glCompileShaderARB");
+			LoadFunction(GetShaderiv, "glGetShaderiv", "glGetObjectParameterivARB");
+			LoadFunction(GetShaderInfoLog, "glGetShaderInfoLog", "glGetInfoLogARB");
+			LoadFunction(CreateProgram, "glCreateProgram", "glCreateProgramObjectARB");
+			LoadFunction(DeleteProgram, "glDeleteProgram", "glDeleteObjectARB");
+			LoadFunction(AttachShader, "glAttachShader", "glAttachObjectARB");
+			LoadFunction(LinkProgram, "glLinkProgram", "glLinkProgramARB");
+			LoadFunction(GetProgramiv, "glGetProgramiv", "glGetObjectParameterivARB");
+			LoadFunction(UseProgram, "glUseProgram", "glUseProgramObjectARB");
+			LoadFunction(BindAttribLocation, "glBindAttribLocation", "glBindAttribLocationARB");
+			LoadFunction(GetAttribLocation, "glGetAttribLocation", "glGetAttribLocationARB");
+			LoadFunction(GetUniformLocation, "glGetUniformLocation", "glGetUniformLocationARB");
+			LoadFunction(Uniform1i, "glUniform1i", "glUniform1iARB");
+			LoadFunction(EnableVertexAttribArray, "glEnableVertexAttribArray", "glEnableVertexAttribArrayARB");
+			LoadFunction(DisableVertexAttribArray, "glDisableVertexAttribArray", "glDisableVertexAttribArrayARB");
+			LoadFunction(VertexAttribPointer, "glVertexAttribPointer", "glVertexAttribPointerARB");
+			LoadFunction(VertexAttribDivisor, "glVertexAttribDivisor", "glVertexAttribDivisorARB");
+			LoadFunction(DrawElementsInstanced, "glDrawElementsInstanced", "glDrawElementsInstancedARB");
+			LoadFunction(GenVertexArrays, "glGenVertexArrays", "glGenVertexArraysAPPLE");
+			LoadFunction(DeleteVertexArrays, "glDeleteVertexArrays", "glDeleteVertexArraysAPPLE");
+			LoadFunction(BindVertexArray, "glBindVertexArray", "glBindVertexArrayAPPLE");
+			LoadFunction(GetUniformBlockIndex, "glGetUniformBlockIndex", "glGetUniformBlockIndexARB");
+			LoadFunction(UniformBlockBinding, "glUniformBlockBinding", "glUniformBlockBindingARB");
+			LoadFunction(BindBufferBase, "glBindBufferBase", "glBindBufferBaseEXT");
+			LoadFunction(TexBuffer, "glTexBuffer", "glTexBufferARB");
+			LoadFunction(ActiveTexture, "glActiveTexture", "glActiveTextureARB");
+		}
+
+		bool BufferObjects()
+		{
+			return GenBuffers && DeleteBuffers && BindBuffer && BufferData && BufferSubData;
+		}
+
+		bool PointParameters()
+		{
+			return PointParameterf && PointParameterfv;
+		}
+
+		bool Shaders()
+		{
+			return CreateShader && DeleteShader && ShaderSource && CompileShader && GetShaderiv && GetShaderInfoLog &&
+				CreateProgram && DeleteProgram && AttachShader && LinkProgram && GetProgramiv && UseProgram &&
+				BindAttribLocation && GetAttribLocation && GetUniformLocation && Uniform1i &&
+				EnableVertexAttribArray && DisableVertexAttribArray && VertexAttribPointer;
+		}
+
+		bool Instancing()
+		{
+			return BufferObjects() && Shaders() && VertexAttribDivisor && DrawElementsInstanced;
+		}
+
+		//"major.minor[.release] vendor information"
+		static bool Version(int required_major, int required_minor)
+		{
+			const char* version = (const char*)glGetString(GL_VERSION);
+			int major = 0, minor = 0;
+			return version && (sscanf(version, "%d.%d", &major, &minor) == 2) && (major * 10 + minor >= required_major * 10 + required_minor);
+		}
+
+		bool VertexArrayBGRA()
+		{
+			static int supported = -1;
+			if (supported < 0)
+			{
+				const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+				supported = Version(3, 2) || (extensions && (strstr(extensions, "GL_ARB_vertex_array_bgra") || strstr(extensions, "GL_EXT_vertex_array_bgra")));
+			}
+			return supported != 0;
+		}
+
+		bool Version33()
+		{
+			if (!Version(3, 3))
+				return false;
+
+			return Instancing() && GenVertexArrays && DeleteVertexArrays && BindVertexArray &&
+				GetUniformBlockIndex && UniformBlockBinding && BindBufferBase && TexBuffer && ActiveTexture;
+		}
+	}
+}
@@ -0,0 +1,120 @@
+#pragma once
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+#include <GL/glut.h>
+#include <cstddef>
+
+//OpenGL 1.4/1.5 enums missing from the OpenGL 1.1 headers on Windows
+#ifndef GL_ARRAY_BUFFER
+#define GL_ARRAY_BUFFER 0x8892
+#define GL_ELEMENT_ARRAY_BUFFER 0x8893
+#define GL_STREAM_DRAW 0x88E0
+#define GL_STATIC_DRAW 0x88E4
+#endif
+
+#ifndef GL_POINT_SIZE_MIN
+#define GL_POINT_SIZE_MIN 0x8126
+#define GL_POINT_SIZE_MAX 0x8127
+#define GL_POINT_DISTANCE_ATTENUATION 0x8129
+#endif
+
+//OpenGL 2.0 shader enums
+#ifndef GL_VERTEX_SHADER
+#define GL_FRAGMENT_SHADER 0x8B30
+#define GL_VERTEX_SHADER 0x8B31
+#define GL_COMPILE_STATUS 0x8B81
+#define GL_LINK_STATUS 0x8B82
+#endif
+
+//OpenGL 3.x enums
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#define GL_TEXTURE_BUFFER 0x8C2A
+#define GL_RGBA32F 0x8814
+#endif
+
+#ifndef GL_TEXTURE0
+#define GL_TEXTURE0 0x84C0
+#endif
+
+#ifndef GL_BGRA
+#define GL_BGRA 0x80E1
+#endif
+
+#ifndef APIENTRY
+#define APIENTRY
+#endif
+
+namespace VisualDebugger
+{
+	///OpenGL functions newer than 1.1, Windows only exports OpenGL 1.1 so they are loaded at runtime
+	namespace GLExt
+	{
+		typedef std::ptrdiff_t GLsizeiptr;
+		typedef std::ptrdiff_t GLintptr;
+		typedef char GLchar;
+
+		extern void (APIENTRY *GenBuffers)(GLsizei n, GLuint* buffers);
+		extern void (APIENTRY *DeleteBuffers)(GLsizei n, const GLuint* buffers);
+		extern void (APIENTRY *BindBuffer)(GLenum target, GLuint buffer);
+		extern void (APIENTRY *BufferData)(GLenum target, GLsizeiptr size, const void* data, GLenum usage);
+		extern void (APIENTRY *BufferSubData)(GLenum target, GLintptr offset, GLsizeiptr size, const void* data);
+		extern void (APIENTRY *PointParameterf)(GLenum pname, GLfloat param);
+		extern void (APIENTRY *PointParameterfv)(GLenum pname, const GLfloat* params);
+		extern GLuint (APIENTRY *CreateShader)(GLenum type);
+		extern void (APIENTRY *DeleteShader)(GLuint shader);
+		extern void (APIENTRY *ShaderSource)(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length);
+		extern void (APIENTRY *CompileShader)(GLuint shader);
+		extern void (APIENTRY *GetShaderiv)(GLuint shader, GLenum pname, GLint* params);
+		extern void (APIENTRY *GetShaderInfoLog)(GLuint shader, GLsizei size, GLsizei* length, GLchar* log);
+		extern GLuint (APIENTRY *CreateProgram)();
+		extern void (APIENTRY *DeleteProgram)(GLuint program);
+		extern void (APIENTRY *AttachShader)(GLuint program, GLuint shader);
+		extern void (APIENTRY *LinkProgram)(GLuint program);
+		extern void (APIENTRY *GetProgramiv)(GLuint program, GLenum pname, GLint* params);
+		extern void (APIENTRY *UseProgram)(GLuint program);
+		extern void (APIENTRY *BindAttribLocation)(GLuint program, GLuint index, const GLchar* name);
+		extern GLint (APIENTRY *GetAttribLocation)(GLuint program, const GLchar* name);
+		extern GLint (APIENTRY *GetUniformLocation)(GLuint program, const GLchar* name);
+		extern void (APIENTRY *Uniform1i)(GLint location, GLint value);
+		extern void (APIENTRY *EnableVertexAttribArray)(GLuint index);
+		extern void (APIENTRY *DisableVertexAttribArray)(GLuint index);
+		extern void (APIENTRY *VertexAttribPointer)(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const void* pointer);
+		extern void (APIENTRY *VertexAttribDivisor)(GLuint index, GLuint divisor);
+		extern void (APIENTRY *DrawElementsInstanced)(GLenum mode, GLsizei count, GLenum type, const void* indices, GLsizei instances);
+		extern void (APIENTRY *GenVertexArrays)(GLsizei n, GLuint* arrays);
+		extern void (APIENTRY *DeleteVertexArrays)(GLsizei n, const GLuint* arrays);
+		extern void (APIENTRY *BindVertexArray)(GLuint array);
+		extern GLuint (APIENTRY *GetUniformBlockIndex)(GLuint program, const GLchar* name);
+		extern void (APIENTRY *UniformBlockBinding)(GLuint program, GLuint index, GLuint binding);
+		extern void (APIENTRY *BindBufferBase)(GLenum target, GLuint index, GLuint buffer);
+		extern void (APIENTRY *TexBuffer)(GLenum target, GLenum format, GLuint buffer);
+		extern void (APIENTRY *ActiveTexture)(GLenum texture);
+
+		///Load the functions, needs a current rendering context (called by Renderer::Init)
+		void Load();
+
+		///Vertex buffer objects are available (OpenGL 1.5)
+		bool BufferObjects();
+
+		///Point size attenuation is available (OpenGL 1.4)
+		bool PointParameters();
+
+		///GLSL programs are available (OpenGL 2.0)
+		bool Shaders();
+
+		///Instanced draws with per-instance attributes are available (OpenGL 3.3 or ARB_draw_instanced and ARB_instanced_arrays)
+		bool Instancing();
+
+		///Colour arrays can be given in BGRA order (OpenGL 3.2 or ARB_vertex_array_bgra)
+		bool VertexArrayBGRA();
+
+		///The context is OpenGL 3.3 or newer (vertex arrays, uniform and texture buffers, GLSL 3.30)
+		bool Version33();
+	}
+}
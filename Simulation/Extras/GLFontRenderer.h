@@ -9,6 +9,8 @@
 #ifndef __GL_FONT_RENDERER__
 #define __GL_FONT_RENDERER__
 
+#include <vector>
+
 class GLFontRenderer{
 	
 private:
@@ -23,6 +25,10 @@ public:
 	
 	static bool init();
 	static void print(float x, float y, float fontSize, const char* pString, bool forceMonoSpace=false, int monoSpaceWidth=11, bool doOrthoProj=true);
+	// append the glyph quads of a string in pixels (x, y, u, v per vertex, 6 vertices per glyph)
+	static void tessellate(float x, float y, float fontSize, const char* pString, std::vector<float>& vertices, bool forceMonoSpace=false, int monoSpaceWidth=11);
+	// draw tessellated glyphs in one call, the pointer can be an offset into the bound array buffer
+	static void draw(const float* pVertices, unsigned int numVertices, bool doOrthoProj=true);
 	static void setScreenResolution(int screenWidth, int screenHeight);
 	static void setColor(float r, float g, float b, float a);
 	
@@ -3,15 +3,35 @@
 #include "Renderer.h"
 #include <string>
 #include <list>
+#include <algorithm>
 
 namespace VisualDebugger
 {
 	using namespace std;
 
-	///A single HUD screen
+	///A single HUD screen, its glyphs are tessellated once and drawn with one call
 	class HUDScreen
 	{
 		vector<string> content;
+		//glyph quads of every line, only the changed lines are tessellated again
+		vector<vector<float> > line_vertices;
+		vector<bool> line_changed;
+		Renderer::TextGeometry geometry;
+		bool changed;
+		//layout of the tessellated glyphs
+		int window_width, window_height;
+		PxReal layout_font_size;
+
+		void Changed(unsigned int index)
+		{
+			if (index >= line_changed.size())
+			{
+				line_changed.resize(index + 1, true);
+				line_vertices.resize(index + 1);
+			}
+			line_changed[index] = true;
+			changed = true;
+		}
 
 	public:
 		int id;
@@ -19,7 +39,7 @@ namespace VisualDebugger
 		PxVec3 color;
 
 		HUDScreen(int screen_id, const PxVec3& _color=PxVec3(1.f,1.f,1.f), const PxReal& _font_size=0.024f) :
-			id(screen_id), color(_color), font_size(_font_size)
+			changed(true), window_width(0), window_height(0), layout_font_size(0.f), id(screen_id), color(_color), font_size(_font_size)
 		{
 		}
 
@@ -27,19 +47,93 @@ namespace VisualDebugger
 		void AddLine(string line)
 		{
 			content.push_back(line);
+			Changed((unsigned int)content.size() - 1);
+		}
+
+		///Replace a single line of text (lines are added up to the index if needed)
+		void SetLine(unsigned int index, string line)
+		{
+			if (index >= content.size())
+			{
+				for (unsigned int i = (unsigned int)content.size(); i <= index; i++)
+					Changed(i);
+				content.resize(index + 1);
+			}
+			if (content[index] != line)
+			{
+				content[index] = line;
+				Changed(index);
+			}
+		}
+
+		///Number of lines
+		unsigned int Lines()
+		{
+			return (unsigned int)content.size();
 		}
 
 		///Render the screen
 		void Render()
 		{
-			for (unsigned int i = 0; i < content.size(); i++)
-				Renderer::RenderText(content[i], PxVec2(0.0, 1.f-(i+1)*font_size), color, font_size);
+			//the glyphs are laid out in pixels
+			if ((window_width != Renderer::WindowWidth()) || (window_height != Renderer::WindowHeight()) || (layout_font_size != font_size))
+			{
+				window_width = Renderer::WindowWidth();
+				window_height = Renderer::WindowHeight();
+				layout_font_size = font_size;
+				for (unsigned int i = 0; i < content.size(); i++)
+					Changed(i);
+			}
+
+			if (changed)
+			{
+				//a changed line of the same length is replaced in place and only it is uploaded,
+				//the lines after one of another length move and are uploaded from there on
+				size_t offset = 0;
+				bool moved = false;
+				size_t moved_from = 0;
+				for (unsigned int i = 0; i < content.size(); i++)
+				{
+					if (line_changed[i])
+					{
+						size_t size = line_vertices[i].size();
+						line_vertices[i].clear();
+						Renderer::TessellateText(content[i], PxVec2(0.0, 1.f-(i+1)*font_size), font_size, line_vertices[i]);
+						line_changed[i] = false;
+
+						if (!moved && (line_vertices[i].size() == size))
+						{
+							std::copy(line_vertices[i].begin(), line_vertices[i].end(), geometry.vertices.begin() + offset);
+							geometry.Changed(offset, offset + size);
+						}
+						else if (!moved)
+						{
+							moved = true;
+							moved_from = offset;
+							geometry.vertices.resize(offset);
+						}
+					}
+					if (moved)
+						geometry.vertices.insert(geometry.vertices.end(), line_vertices[i].begin(), line_vertices[i].end());
+					offset += line_vertices[i].size();
+				}
+				//the lines removed by Clear
+				geometry.vertices.resize(offset);
+				if (moved)
+					geometry.Changed(moved_from, offset);
+				changed = false;
+			}
+
+			Renderer::RenderText(geometry, color);
 		}
 
 		///Clear content of the screen
 		void Clear()
 		{
 			content.clear();
+			line_vertices.clear();
+			line_changed.clear();
+			changed = true;
 		}
 	};
 
@@ -72,6 +166,33 @@ namespace VisualDebugger
 			screens.back()->AddLine(line);
 		}
 
+		///Replace a single line of a specific screen
+		void SetLine(int screen_id, unsigned int index, string line)
+		{
+			for (unsigned int i = 0; i < screens.size(); i++)
+			{
+				if (screens[i]->id == screen_id)
+				{
+					screens[i]->SetLine(index, line);
+					return;
+				}
+			}
+
+			screens.push_back(new HUDScreen(screen_id));
+			screens.back()->SetLine(index, line);
+		}
+
+		///Number of lines of a specific screen
+		unsigned int Lines(int screen_id)
+		{
+			for (unsigned int i = 0; i < screens.size(); i++)
+			{
+				if (screens[i]->id == screen_id)
+					return screens[i]->Lines();
+			}
+			return 0;
+		}
+
 		///Set the active screen
 		void ActiveScreen(int value)
 		{
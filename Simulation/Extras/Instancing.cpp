@@ -0,0 +1,156 @@
+#include "Instancing.h"
+#include <iostream>
+
+namespace VisualDebugger
+{
+	namespace Instancing
+	{
+		using namespace std;
+
+		static const GLchar* vertex_source =
+			"#version 120\n"
+			"attribute vec4 instance0;\n"
+			"attribute vec4 instance1;\n"
+			"attribute vec4 instance2;\n"
+			"attribute vec4 instance3;\n"
+			"uniform int lit;\n"
+			"void main()\n"
+			"{\n"
+			"	mat4 model = mat4(instance0, instance1, instance2, instance3);\n"
+			"	gl_Position = gl_ModelViewProjectionMatrix * (model * gl_Vertex);\n"
+			"	if (lit == 0)\n"
+			"	{\n"
+			"		gl_FrontColor = gl_Color;\n"
+			"		return;\n"
+			"	}\n"
+			//directional light 0 with the colour tracking the ambient and diffuse material
+			"	vec3 normal = normalize(gl_NormalMatrix * (mat3(model) * gl_Normal));\n"
+			"	float diffuse = max(dot(normal, normalize(gl_LightSource[0].position.xyz)), 0.0);\n"
+			"	vec4 color = gl_Color * (gl_LightModel.ambient + gl_LightSource[0].ambient + gl_LightSource[0].diffuse * diffuse);\n"
+			"	if (diffuse > 0.0)\n"
+			"		color += gl_FrontMaterial.specular * gl_LightSource[0].specular *\n"
+			"			pow(max(dot(normal, normalize(gl_LightSource[0].halfVector.xyz)), 0.0), gl_FrontMaterial.shininess);\n"
+			"	gl_FrontColor = vec4(color.rgb, gl_Color.a);\n"
+			"}\n";
+
+		static const GLchar* fragment_source =
+			"#version 120\n"
+			"void main()\n"
+			"{\n"
+			"	gl_FragColor = gl_Color;\n"
+			"}\n";
+
+		static GLuint program = 0;
+		static const GLchar* instance_names[4] = { "instance0", "instance1", "instance2", "instance3" };
+		static const GLuint instance_attributes[4] = { 1, 2, 3, 4 };
+		static GLint lit_uniform = -1;
+		//transforms of the current instances, streamed before every group
+		static GLuint instance_buffer = 0;
+
+		static GLuint Compile(GLenum type, const GLchar* source)
+		{
+			GLuint shader = GLExt::CreateShader(type);
+			GLExt::ShaderSource(shader, 1, &source, 0);
+			GLExt::CompileShader(shader);
+
+			GLint status = 0;
+			GLExt::GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				GLchar log[1024];
+				GLExt::GetShaderInfoLog(shader, sizeof(log), 0, log);
+				cerr << "Instancing shader error: " << log << endl;
+				GLExt::DeleteShader(shader);
+				return 0;
+			}
+			return shader;
+		}
+
+		void Init()
+		{
+			if (program || !GLExt::Instancing())
+				return;
+
+			GLuint vertex_shader = Compile(GL_VERTEX_SHADER, vertex_source);
+			GLuint fragment_shader = Compile(GL_FRAGMENT_SHADER, fragment_source);
+			if (vertex_shader && fragment_shader)
+			{
+				program = GLExt::CreateProgram();
+				GLExt::AttachShader(program, vertex_shader);
+				GLExt::AttachShader(program, fragment_shader);
+				//fixed locations from 1 up, the linker may otherwise put a matrix column at 0 (aliased with gl_Vertex)
+				for (int i = 0; i < 4; i++)
+					GLExt::BindAttribLocation(program, instance_attributes[i], instance_names[i]);
+				GLExt::LinkProgram(program);
+
+				GLint status = 0;
+				GLExt::GetProgramiv(program, GL_LINK_STATUS, &status);
+				if (!status)
+				{
+					GLExt::DeleteProgram(program);
+					program = 0;
+				}
+			}
+			//the program keeps the shaders alive
+			if (vertex_shader)
+				GLExt::DeleteShader(vertex_shader);
+			if (fragment_shader)
+				GLExt::DeleteShader(fragment_shader);
+
+			if (!program)
+				return;
+
+			lit_uniform = GLExt::GetUniformLocation(program, "lit");
+			GLExt::GenBuffers(1, &instance_buffer);
+		}
+
+		bool Enabled()
+		{
+			return program != 0;
+		}
+
+		void Instances(const PxMat44* transforms, PxU32 count)
+		{
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+			GLExt::BufferData(GL_ARRAY_BUFFER, count * sizeof(PxMat44), transforms, GL_STREAM_DRAW);
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		void Draw(const RenderMesh& mesh, PxU32 count, bool lit)
+		{
+			if (!mesh.index_count || !mesh.vertex_buffer || !count)
+				return;
+
+			GLExt::UseProgram(program);
+			GLExt::Uniform1i(lit_uniform, lit ? 1 : 0);
+
+			//one matrix column per attribute, advanced once per instance
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, instance_buffer);
+			for (int i = 0; i < 4; i++)
+			{
+				GLExt::EnableVertexAttribArray(instance_attributes[i]);
+				GLExt::VertexAttribPointer(instance_attributes[i], 4, GL_FLOAT, GL_FALSE, sizeof(PxMat44), (const char*)0 + i * sizeof(PxVec4));
+				GLExt::VertexAttribDivisor(instance_attributes[i], 1);
+			}
+
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+			GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(RenderMesh::Vertex), 0);
+			glNormalPointer(GL_FLOAT, sizeof(RenderMesh::Vertex), (const char*)0 + sizeof(PxVec3));
+			GLExt::DrawElementsInstanced(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, 0, count);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			for (int i = 0; i < 4; i++)
+			{
+				GLExt::VertexAttribDivisor(instance_attributes[i], 0);
+				GLExt::DisableVertexAttribArray(instance_attributes[i]);
+			}
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+			GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			GLExt::UseProgram(0);
+		}
+	}
+}
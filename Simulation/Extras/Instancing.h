@@ -0,0 +1,27 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "MeshCache.h"
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Instanced drawing of render meshes: a small GLSL program reads a per-instance transform
+	///from a streamed buffer and reproduces the fixed-function lighting of the renderer (light 0, colour material).
+	namespace Instancing
+	{
+		///Compile the program, needs the OpenGL functions to be loaded (called by Renderer::Init)
+		void Init();
+
+		///Instanced drawing is supported by the driver and the program compiled
+		bool Enabled();
+
+		///Stream the transforms of the instances used by the following draws
+		void Instances(const PxMat44* transforms, PxU32 count);
+
+		///Draw the mesh once per instance in a single call (in the current model view matrix and colour),
+		///unlit draws use the plain colour (e.g. for shadows)
+		void Draw(const RenderMesh& mesh, PxU32 count, bool lit=true);
+	}
+}
@@ -0,0 +1,309 @@
+#include "MeshCache.h"
+#include <map>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace MeshCache
+	{
+		using namespace std;
+
+		//entries keyed by the PhysX mesh
+		static map<const PxBase*, RenderMesh> meshes;
+
+		//unit cylinders keyed by the number of slices
+		static map<PxU32, RenderMesh> cylinders;
+		//unit spheres keyed by the number of slices and stacks
+		static map<pair<PxU32, PxU32>, RenderMesh> spheres;
+		static RenderMesh box;
+		static RenderMesh plane;
+
+		//meshes released since the last flush, the listener can be called from any thread
+		//so the buffer objects are deleted later by the rendering thread
+		static vector<const PxBase*> released;
+		static mutex released_mutex;
+
+		class ReleaseListener : public PxDeletionListener
+		{
+		public:
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				lock_guard<mutex> lock(released_mutex);
+				released.push_back(observed);
+			}
+		};
+
+		static ReleaseListener listener;
+		static bool listening = false;
+
+		void Init()
+		{
+			if (listening)
+				return;
+
+			//a mesh released by the user may still be used by shapes, the entry is rebuilt if drawn again
+			PxGetPhysics().registerDeletionListener(listener, PxDeletionEventFlag::eUSER_RELEASE | PxDeletionEventFlag::eMEMORY_RELEASE);
+			listening = true;
+		}
+
+		static void Release(RenderMesh& mesh)
+		{
+			if (mesh.vertex_buffer)
+				GLExt::DeleteBuffers(1, &mesh.vertex_buffer);
+			if (mesh.index_buffer)
+				GLExt::DeleteBuffers(1, &mesh.index_buffer);
+			if (mesh.vertex_array)
+				GLExt::DeleteVertexArrays(1, &mesh.vertex_array);
+		}
+
+		void Flush()
+		{
+			lock_guard<mutex> lock(released_mutex);
+			for (const PxBase* object : released)
+			{
+				map<const PxBase*, RenderMesh>::iterator it = meshes.find(object);
+				if (it != meshes.end())
+				{
+					Release(it->second);
+					meshes.erase(it);
+				}
+			}
+			released.clear();
+		}
+
+		//copy the arrays into buffer objects when available
+		static void Upload(RenderMesh& mesh)
+		{
+			mesh.index_count = (GLsizei)mesh.indices.size();
+			if (!GLExt::BufferObjects() || mesh.vertices.empty())
+				return;
+
+			GLExt::GenBuffers(1, &mesh.vertex_buffer);
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+			GLExt::BufferData(GL_ARRAY_BUFFER, mesh.vertices.size() * sizeof(RenderMesh::Vertex), &mesh.vertices.front(), GL_STATIC_DRAW);
+			GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+
+			GLExt::GenBuffers(1, &mesh.index_buffer);
+			GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+			GLExt::BufferData(GL_ELEMENT_ARRAY_BUFFER, mesh.indices.size() * sizeof(GLuint), &mesh.indices.front(), GL_STATIC_DRAW);
+			GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+		}
+
+		const RenderMesh& Get(const PxConvexMesh* convex)
+		{
+			map<const PxBase*, RenderMesh>::iterator it = meshes.find(convex);
+			if (it != meshes.end())
+				return it->second;
+
+			RenderMesh& mesh = meshes[convex];
+			const PxVec3* verts = convex->getVertices();
+			const PxU8* indices = convex->getIndexBuffer();
+
+			//every polygon is convex: a triangle fan with the polygon normal
+			for (PxU32 i = 0; i < convex->getNbPolygons(); i++)
+			{
+				PxHullPolygon face;
+				if (!convex->getPolygonData(i, face) || (face.mNbVerts < 3))
+					continue;
+
+				PxVec3 normal(face.mPlane[0], face.mPlane[1], face.mPlane[2]);
+				GLuint first = (GLuint)mesh.vertices.size();
+				for (PxU32 j = 0; j < face.mNbVerts; j++)
+				{
+					RenderMesh::Vertex vertex = { verts[indices[face.mIndexBase + j]], normal };
+					mesh.vertices.push_back(vertex);
+				}
+				for (PxU32 j = 1; j + 1 < face.mNbVerts; j++)
+				{
+					mesh.indices.push_back(first);
+					mesh.indices.push_back(first + j);
+					mesh.indices.push_back(first + j + 1);
+				}
+			}
+
+			Upload(mesh);
+			return mesh;
+		}
+
+		const RenderMesh& Get(const PxTriangleMesh* triangles)
+		{
+			map<const PxBase*, RenderMesh>::iterator it = meshes.find(triangles);
+			if (it != meshes.end())
+				return it->second;
+
+			RenderMesh& mesh = meshes[triangles];
+			const PxVec3* verts = triangles->getVertices();
+			const PxU32 num_trigs = triangles->getNbTriangles();
+			const bool has_16bit = (triangles->getTriangleMeshFlags() & PxTriangleMeshFlag::e16_BIT_INDICES);
+			const PxU16* trigs16 = (const PxU16*)triangles->getTriangles();
+			const PxU32* trigs32 = (const PxU32*)triangles->getTriangles();
+
+			//flat shading: the vertices are not shared so that every triangle has its own normal
+			mesh.vertices.reserve(num_trigs * 3);
+			mesh.indices.reserve(num_trigs * 3);
+			for (PxU32 i = 0; i < num_trigs * 3; i += 3)
+			{
+				PxVec3 v[3];
+				for (PxU32 j = 0; j < 3; j++)
+					v[j] = verts[has_16bit ? trigs16[i + j] : trigs32[i + j]];
+
+				PxVec3 normal = (v[1] - v[0]).cross(v[2] - v[0]);
+				normal.normalize();
+				for (PxU32 j = 0; j < 3; j++)
+				{
+					RenderMesh::Vertex vertex = { v[j], normal };
+					mesh.indices.push_back((GLuint)mesh.vertices.size());
+					mesh.vertices.push_back(vertex);
+				}
+			}
+
+			Upload(mesh);
+			return mesh;
+		}
+
+		const RenderMesh& Cylinder(PxU32 slices)
+		{
+			map<PxU32, RenderMesh>::iterator it = cylinders.find(slices);
+			if (it != cylinders.end())
+				return it->second;
+
+			RenderMesh& mesh = cylinders[slices];
+			//the lighting does not change along the axis so a single stack is enough,
+			//the seam vertices are duplicated to close the strip
+			for (PxU32 i = 0; i <= slices; i++)
+			{
+				PxReal angle = PxTwoPi * i / slices;
+				PxVec3 normal(cosf(angle), 0.f, sinf(angle));
+				RenderMesh::Vertex bottom = { normal + PxVec3(0.f, -1.f, 0.f), normal };
+				RenderMesh::Vertex top = { normal + PxVec3(0.f, 1.f, 0.f), normal };
+				mesh.vertices.push_back(bottom);
+				mesh.vertices.push_back(top);
+			}
+			for (GLuint i = 0; i < slices * 2; i += 2)
+			{
+				mesh.indices.push_back(i);
+				mesh.indices.push_back(i + 1);
+				mesh.indices.push_back(i + 2);
+				mesh.indices.push_back(i + 2);
+				mesh.indices.push_back(i + 1);
+				mesh.indices.push_back(i + 3);
+			}
+
+			Upload(mesh);
+			return mesh;
+		}
+
+		const RenderMesh& Box()
+		{
+			if (box.index_count)
+				return box;
+
+			//a quad per face, the corners are the normal plus the two other axes
+			for (PxU32 axis = 0; axis < 3; axis++)
+			{
+				for (PxReal side = -1.f; side <= 1.f; side += 2.f)
+				{
+					PxVec3 normal(0.f), u(0.f), v(0.f);
+					normal[axis] = side;
+					u[(axis + 1) % 3] = 1.f;
+					v[(axis + 2) % 3] = side;
+					GLuint first = (GLuint)box.vertices.size();
+					RenderMesh::Vertex corners[] = {
+						{ normal - u - v, normal }, { normal + u - v, normal }, { normal + u + v, normal }, { normal - u + v, normal } };
+					box.vertices.insert(box.vertices.end(), corners, corners + 4);
+					GLuint quad[] = { first, first + 1, first + 2, first, first + 2, first + 3 };
+					box.indices.insert(box.indices.end(), quad, quad + 6);
+				}
+			}
+
+			Upload(box);
+			return box;
+		}
+
+		const RenderMesh& Sphere(PxU32 slices, PxU32 stacks)
+		{
+			map<pair<PxU32, PxU32>, RenderMesh>::iterator it = spheres.find(make_pair(slices, stacks));
+			if (it != spheres.end())
+				return it->second;
+
+			RenderMesh& mesh = spheres[make_pair(slices, stacks)];
+			for (PxU32 i = 0; i <= stacks; i++)
+			{
+				PxReal polar = PxPi * i / stacks;
+				for (PxU32 j = 0; j <= slices; j++)
+				{
+					PxReal azimuth = PxTwoPi * j / slices;
+					PxVec3 normal(sinf(polar) * cosf(azimuth), cosf(polar), sinf(polar) * sinf(azimuth));
+					RenderMesh::Vertex vertex = { normal, normal };
+					mesh.vertices.push_back(vertex);
+				}
+			}
+			for (GLuint i = 0; i < stacks; i++)
+			{
+				for (GLuint j = 0; j < slices; j++)
+				{
+					GLuint a = i * (slices + 1) + j, b = a + slices + 1;
+					GLuint quad[] = { a, b, a + 1, a + 1, b, b + 1 };
+					mesh.indices.insert(mesh.indices.end(), quad, quad + 6);
+				}
+			}
+
+			Upload(mesh);
+			return mesh;
+		}
+
+		const RenderMesh& Plane()
+		{
+			if (plane.index_count)
+				return plane;
+
+			PxVec3 up(0.f, 1.f, 0.f);
+			RenderMesh::Vertex corners[] = {
+				{ PxVec3(-1.f, 0.f, -1.f), up }, { PxVec3(-1.f, 0.f, 1.f), up }, { PxVec3(1.f, 0.f, 1.f), up }, { PxVec3(1.f, 0.f, -1.f), up } };
+			plane.vertices.assign(corners, corners + 4);
+			GLuint quad[] = { 0, 1, 2, 0, 2, 3 };
+			plane.indices.assign(quad, quad + 6);
+
+			Upload(plane);
+			return plane;
+		}
+
+		void Draw(const RenderMesh& mesh)
+		{
+			if (!mesh.index_count)
+				return;
+
+			const char* vertices = 0;
+			const GLuint* indices = 0;
+			if (mesh.vertex_buffer)
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+			}
+			else
+			{
+				vertices = (const char*)&mesh.vertices.front();
+				indices = &mesh.indices.front();
+			}
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(RenderMesh::Vertex), vertices);
+			glNormalPointer(GL_FLOAT, sizeof(RenderMesh::Vertex), vertices + sizeof(PxVec3));
+			glDrawElements(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, indices);
+			glDisableClientState(GL_NORMAL_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			if (mesh.vertex_buffer)
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+		}
+
+		PxU32 Size()
+		{
+			return (PxU32)meshes.size();
+		}
+	}
+}
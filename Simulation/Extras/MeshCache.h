@@ -0,0 +1,66 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "GLExtensions.h"
+#include <vector>
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Convex or triangle mesh triangulated for rendering (flat normals)
+	struct RenderMesh
+	{
+		struct Vertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+		};
+
+		//also kept with buffer objects, the static batch bakes them into world space
+		std::vector<Vertex> vertices;
+		std::vector<GLuint> indices;
+		GLuint vertex_buffer;
+		GLuint index_buffer;
+		GLsizei index_count;
+		//vertex array object of the OpenGL 3.3 renderer (created on first use)
+		mutable GLuint vertex_array;
+
+		RenderMesh() : vertex_buffer(0), index_buffer(0), index_count(0), vertex_array(0) {}
+	};
+
+	///Render meshes built once per PhysX mesh and kept in buffer objects,
+	///an entry is evicted when PhysX releases its mesh.
+	namespace MeshCache
+	{
+		///Start listening for released meshes (called by Renderer::Init)
+		void Init();
+
+		///Evict the entries of the meshes released since the last call (called at the start of Renderer::Render)
+		void Flush();
+
+		///Get the render mesh of a convex mesh, built on first use
+		const RenderMesh& Get(const PxConvexMesh* mesh);
+
+		///Get the render mesh of a triangle mesh, built on first use
+		const RenderMesh& Get(const PxTriangleMesh* mesh);
+
+		///Get the side of a cylinder with unit radius and half height along the Y axis (smooth normals), built on first use
+		const RenderMesh& Cylinder(PxU32 slices);
+
+		///Get a box with unit half extents
+		const RenderMesh& Box();
+
+		///Get a sphere with unit radius, built on first use
+		const RenderMesh& Sphere(PxU32 slices, PxU32 stacks);
+
+		///Get a unit square in the XZ plane facing up
+		const RenderMesh& Plane();
+
+		///Draw a render mesh with an indexed call (in the current model view matrix)
+		void Draw(const RenderMesh& mesh);
+
+		///Number of cached meshes
+		PxU32 Size();
+	}
+}
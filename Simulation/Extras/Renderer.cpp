@@ -2,6 +2,20 @@
 #include <iostream>
 #include <vector>
 #include "UserData.h"
+#include "GLExtensions.h"
+#include "MeshCache.h"
+#include "Instancing.h"
+#include "RendererGL3.h"
+#include "StaticBatch.h"
+#include <algorithm>
+
+//SSE is always available on x64
+#if defined(_M_X64) || defined(__SSE2__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+#include <emmintrin.h>
+#define CLOTH_SIMD 1
+#else
+#define CLOTH_SIMD 0
+#endif
 
 using namespace std;
 
@@ -12,7 +26,90 @@ namespace VisualDebugger
 		PxVec3 default_color = PxVec3(0.8f, 0.8f, 0.8f);
 		PxVec3 background_color = PxVec3(0.f, 0.f, 0.f);
 		int render_detail = 10;
+		RenderBackend backend = FIXED_FUNCTION_RENDERER;
 		bool show_shadows = true;
+		//colour of the planar shadows (a darker ground plane)
+		PxVec3 shadow_color = default_color * 0.9f;
+		//projects onto the ground plane along the light direction
+		const PxVec3 shadow_dir(-0.7071067f, -0.7071067f, -0.7071067f);
+		const PxReal shadow_matrix[] = { 1,0,0,0, -shadow_dir.x / shadow_dir.y,0,-shadow_dir.z / shadow_dir.y,0, 0,0,1,0, 0,0,0,1 };
+		//window size in pixels, kept by the reshape callback
+		int window_width = 1;
+		int window_height = 1;
+		//vertical field of view of the camera
+		const PxReal fov_y = 60.f;
+		const PxReal near_plane = 1.f;
+		const PxReal far_plane = 10000.f;
+
+		//camera position and view frustum of the current frame (inward normals), set by Start
+		PxVec3 camera_eye(0.f);
+		PxPlane frustum[6];
+		PxVec3 frustum_edges[4];
+		bool frustum_culling = true;
+		bool static_batching = true;
+		//shapes submitted and skipped since Start
+		PxU32 visible_shapes = 0;
+		PxU32 culled_shapes = 0;
+
+		//particles gathered by Render and drawn in a single call
+		struct ParticleVertex
+		{
+			PxVec3 position;
+			PxVec3 color;
+		};
+		std::vector<ParticleVertex> particle_vertices;
+		PxReal particle_radius = 0.f;
+		//streamed every frame (0 without buffer object support)
+		GLuint particle_buffer = 0;
+
+		//debug data streamed every frame (0 without buffer object support), both only grow
+		GLuint debug_buffer = 0;
+		GLExt::GLsizeiptr debug_buffer_size = 0;
+		//debug colours in RGBA order, without BGRA vertex array support
+		std::vector<PxU32> debug_colors;
+
+		//graph frame and samples in window coordinates [0..1], only grows
+		std::vector<PxVec2> graph_vertices;
+
+		//cloth vertex normals, shared by all cloths (recomputed for each)
+		std::vector<PxVec4> cloth_normals;
+
+		//shapes gathered by Render and drawn in the order of their sort key:
+		//the unlit ground first, then the lit shapes grouped by geometry type, mesh and colour
+		enum DrawPass
+		{
+			UNLIT_PASS,
+			LIT_PASS
+		};
+		struct DrawItem
+		{
+			PxU32 pass;
+			PxU32 type;
+			//convex and triangle meshes only
+			const RenderMesh* mesh;
+			//RGB8, compared instead of the floats
+			PxU32 packed_color;
+			PxVec3 color;
+			PxGeometryHolder geometry;
+			PxMat44 transform;
+
+			bool operator<(const DrawItem& item) const
+			{
+				if (pass != item.pass) return pass < item.pass;
+				if (type != item.type) return type < item.type;
+				if (mesh != item.mesh) return mesh < item.mesh;
+				return packed_color < item.packed_color;
+			}
+		};
+		//kept between frames to reuse the arrays
+		std::vector<DrawItem> draw_queue;
+		std::vector<PxMat44> instance_transforms;
+		//lighting, colour and mesh changes made since Start
+		PxU32 state_changes = 0;
+		//current state of the queue submission, redundant changes are skipped
+		bool lighting_state = true;
+		bool color_valid = false;
+		PxVec3 color_state;
 
 		static float gPlaneData[] = {
 			-1.f, 0.f, -1.f, 0.f, 1.f, 0.f, -1.f, 0.f, 1.f, 0.f, 1.f, 0.f,
@@ -77,50 +174,12 @@ namespace VisualDebugger
 
 		void DrawConvexMesh(const PxGeometryHolder& geometry)
 		{
-			PxConvexMesh* mesh = geometry.convexMesh().convexMesh;
-			PxU32 num_polys = mesh->getNbPolygons();
-			const PxVec3* verts = mesh->getVertices();
-			const PxU8* indicies = mesh->getIndexBuffer();
-
-			for (PxU32 i = 0; i < num_polys; i++)
-			{
-				PxHullPolygon face;
-				if (mesh->getPolygonData(i, face))
-				{
-					glBegin(GL_POLYGON);
-					glNormal3f(face.mPlane[0], face.mPlane[1], face.mPlane[2]);
-					const PxU8* faceIdx = indicies + face.mIndexBase;
-					for (PxU32 j = 0; j < face.mNbVerts; j++)
-					{
-						PxVec3 v = verts[faceIdx[j]];
-						glVertex3f(v.x, v.y, v.z);
-					}
-					glEnd();
-				}
-			}
+			MeshCache::Draw(MeshCache::Get(geometry.convexMesh().convexMesh));
 		}
 
 		void DrawTriangleMesh(const PxGeometryHolder& geometry)
 		{
-			PxTriangleMesh* mesh = geometry.triangleMesh().triangleMesh;
-			const PxVec3* verts = mesh->getVertices();
-			PxU16* trigs = (PxU16*)mesh->getTriangles();
-			const PxU32 num_trigs = mesh->getNbTriangles();
-
-			for (PxU32 i = 0; i < num_trigs * 3; i += 3)
-			{
-				PxVec3 v0 = verts[trigs[i]];
-				PxVec3 v1 = verts[trigs[i + 1]];
-				PxVec3 v2 = verts[trigs[i + 2]];
-				PxVec3 n = (v1 - v0).cross(v2 - v0);
-				n.normalize();
-				glBegin(GL_POLYGON);
-				glNormal3f(n.x, n.y, n.z);
-				glVertex3f(v0.x, v0.y, v0.z);
-				glVertex3f(v1.x, v1.y, v1.z);
-				glVertex3f(v2.x, v2.y, v2.z);
-				glEnd();
-			}
+			MeshCache::Draw(MeshCache::Get(geometry.triangleMesh().triangleMesh));
 		}
 
 		void DrawHeightField(const PxGeometryHolder& geometry)
@@ -158,6 +217,69 @@ namespace VisualDebugger
 			}
 		}
 
+		//accumulate the normal of every quad at its vertices and normalise them,
+		//positions are read in place from the locked particles (x, y, z, inverse weight)
+		static void ClothNormals(const PxClothParticle* particles, PxU32 num_particles, const PxU32* quads, PxU32 quad_count, PxVec4* normals)
+		{
+			const PxReal* positions = (const PxReal*)particles;
+			PxReal* result = (PxReal*)normals;
+#if CLOTH_SIMD
+			const __m128 zero = _mm_setzero_ps();
+			for (PxU32 i = 0; i < num_particles; i++)
+				_mm_storeu_ps(result + i * 4, zero);
+
+			//the w lane is cleared so that the inverse weights do not leak into the normals
+			const __m128 xyz_mask = _mm_castsi128_ps(_mm_set_epi32(0, -1, -1, -1));
+			for (PxU32 i = 0; i < quad_count * 4; i += 4)
+			{
+				__m128 v0 = _mm_loadu_ps(positions + quads[i] * 4);
+				__m128 e1 = _mm_sub_ps(_mm_loadu_ps(positions + quads[i + 1] * 4), v0);
+				__m128 e2 = _mm_sub_ps(_mm_loadu_ps(positions + quads[i + 2] * 4), v0);
+				//-(e1 x e2) = e2 x e1
+				__m128 n = _mm_sub_ps(
+					_mm_mul_ps(_mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 0, 2, 1)), _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 1, 0, 2))),
+					_mm_mul_ps(_mm_shuffle_ps(e2, e2, _MM_SHUFFLE(3, 1, 0, 2)), _mm_shuffle_ps(e1, e1, _MM_SHUFFLE(3, 0, 2, 1))));
+				n = _mm_and_ps(n, xyz_mask);
+				for (PxU32 j = 0; j < 4; j++)
+				{
+					PxReal* normal = result + quads[i + j] * 4;
+					_mm_storeu_ps(normal, _mm_add_ps(_mm_loadu_ps(normal), n));
+				}
+			}
+
+			//reciprocal square root refined by one Newton step, unused vertices stay zero
+			const __m128 half = _mm_set1_ps(.5f), three = _mm_set1_ps(3.f), tiny = _mm_set1_ps(1e-30f);
+			for (PxU32 i = 0; i < num_particles; i++)
+			{
+				__m128 n = _mm_loadu_ps(result + i * 4);
+				__m128 sq = _mm_mul_ps(n, n);
+				sq = _mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(2, 3, 0, 1)));
+				sq = _mm_max_ps(_mm_add_ps(sq, _mm_shuffle_ps(sq, sq, _MM_SHUFFLE(1, 0, 3, 2))), tiny);
+				__m128 r = _mm_rsqrt_ps(sq);
+				r = _mm_mul_ps(_mm_mul_ps(half, r), _mm_sub_ps(three, _mm_mul_ps(_mm_mul_ps(sq, r), r)));
+				_mm_storeu_ps(result + i * 4, _mm_mul_ps(n, r));
+			}
+#else
+			for (PxU32 i = 0; i < num_particles; i++)
+				normals[i] = PxVec4(0.f);
+
+			for (PxU32 i = 0; i < quad_count * 4; i += 4)
+			{
+				PxVec3 v0 = particles[quads[i]].pos;
+				PxVec3 n = -((particles[quads[i + 1]].pos - v0).cross(particles[quads[i + 2]].pos - v0));
+				for (PxU32 j = 0; j < 4; j++)
+					normals[quads[i + j]] += PxVec4(n, 0.f);
+			}
+
+			for (PxU32 i = 0; i < num_particles; i++)
+			{
+				PxVec3 n = normals[i].getXYZ();
+				n.normalize();
+				normals[i] = PxVec4(n, 0.f);
+			}
+#endif
+		}
+
 		void RenderCloth(const PxCloth* cloth)
 		{
 			PxClothMeshDesc* mesh_desc = ((UserData*)cloth->userData)->cloth_mesh_desc;
@@ -165,37 +287,16 @@ namespace VisualDebugger
 
 			PxU32 quad_count = mesh_desc->quads.count;
 			PxU32* quads = (PxU32*)mesh_desc->quads.data;
-
-			std::vector<PxVec3> verts(cloth->getNbParticles());
-			std::vector<PxVec3> norms(verts.size(), PxVec3(0.f, 0.f, 0.f));
-
-			//get verts data
-			cloth->lockParticleData();
+			PxU32 num_particles = cloth->getNbParticles();
 
 			PxClothParticleData* particle_data = cloth->lockParticleData();
 			if (!particle_data)
 				return;
-			// copy vertex positions
-			for (PxU32 j = 0; j < verts.size(); j++)
-				verts[j] = particle_data->particles[j].pos;
-
-			particle_data->unlock();
-
-			for (PxU32 i = 0; i < quad_count * 4; i += 4)
-			{
-				PxVec3 v0 = verts[quads[i]];
-				PxVec3 v1 = verts[quads[i + 1]];
-				PxVec3 v2 = verts[quads[i + 2]];
-				PxVec3 n = -((v1 - v0).cross(v2 - v0));
-
-				norms[quads[i]] += n;
-				norms[quads[i + 1]] += n;
-				norms[quads[i + 2]] += n;
-				norms[quads[i + 3]] += n;
-			}
 
-			for (PxU32 i = 0; i < norms.size(); i++)
-				norms[i].normalize();
+			//reused by all cloths, it only grows
+			if (cloth_normals.size() < num_particles)
+				cloth_normals.resize(num_particles);
+			ClothNormals(particle_data->particles, num_particles, quads, quad_count, &cloth_normals.front());
 
 			PxTransform pose = cloth->getGlobalPose();
 			PxMat44 shapePose(pose);
@@ -208,8 +309,9 @@ namespace VisualDebugger
 			glEnableClientState(GL_VERTEX_ARRAY);
 			glEnableClientState(GL_NORMAL_ARRAY);
 
-			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), &verts.front());
-			glNormalPointer(GL_FLOAT, sizeof(PxVec3), &norms.front());
+			//the positions are drawn straight from the particle data, it is unlocked after the draw
+			glVertexPointer(3, GL_FLOAT, sizeof(PxClothParticle), particle_data->particles);
+			glNormalPointer(GL_FLOAT, sizeof(PxVec4), &cloth_normals.front());
 
 			glDrawElements(GL_QUADS, quad_count * 4, GL_UNSIGNED_INT, quads);
 
@@ -217,11 +319,16 @@ namespace VisualDebugger
 			glDisableClientState(GL_VERTEX_ARRAY);
 
 			glPopMatrix();
+
+			particle_data->unlock();
 		}
 
 		void reshapeCallback(int width, int height)
 		{
 			glViewport(0, 0, width, height);
+			window_width = width;
+			//avoid a zero aspect ratio when minimised
+			window_height = PxMax(height, 1);
 		}
 
 		void idleCallback()
@@ -240,6 +347,8 @@ namespace VisualDebugger
 			glutInit(&argc, argv);
 
 			glutInitWindowSize(width, height);
+			window_width = width;
+			window_height = height;
 			glutInitDisplayMode(GLUT_RGB | GLUT_DOUBLE | GLUT_DEPTH);
 			glutSetWindow(glutCreateWindow(name));
 			glutReshapeFunc(reshapeCallback);
@@ -267,6 +376,21 @@ namespace VisualDebugger
 			glLightfv(GL_LIGHT0, GL_DIFFUSE, diffuseColor);
 			glLightfv(GL_LIGHT0, GL_POSITION, position);
 			glEnable(GL_LIGHT0);
+
+			GLExt::Load();
+			if (GLExt::BufferObjects())
+			{
+				GLExt::GenBuffers(1, &particle_buffer);
+				GLExt::GenBuffers(1, &debug_buffer);
+			}
+			MeshCache::Init();
+			StaticBatch::Init();
+			Instancing::Init();
+			if ((backend == GL33_RENDERER) && !RendererGL3::Init())
+			{
+				cerr << "OpenGL 3.3 is not available, using the fixed-function renderer" << endl;
+				backend = FIXED_FUNCTION_RENDERER;
+			}
 		}
 
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir)
@@ -276,11 +400,84 @@ namespace VisualDebugger
 			// Setup camera
 			glMatrixMode(GL_PROJECTION);
 			glLoadIdentity();
-			gluPerspective(60.f, (float)glutGet(GLUT_WINDOW_WIDTH) / (float)glutGet(GLUT_WINDOW_HEIGHT), 1.f, 10000.f);
+			PxReal aspect = (float)window_width / (float)window_height;
+			gluPerspective(fov_y, aspect, near_plane, far_plane);
 
 			glMatrixMode(GL_MODELVIEW);
 			glLoadIdentity();
 			gluLookAt(cameraEye.x, cameraEye.y, cameraEye.z, cameraEye.x + cameraDir.x, cameraEye.y + cameraDir.y, cameraEye.z + cameraDir.z, 0.f, 1.f, 0.f);
+
+			// Setup the view frustum for culling (the same camera as above)
+			camera_eye = cameraEye;
+			PxVec3 forward = cameraDir.getNormalized();
+			PxVec3 right = forward.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+			PxVec3 up = right.cross(forward);
+			PxReal tan_y = tanf(fov_y * PxPi / 360.f);
+			PxReal tan_x = tan_y * aspect;
+			//edges of the frustum through the corners of the screen
+			frustum_edges[0] = forward + right * tan_x + up * tan_y;
+			frustum_edges[1] = forward + right * tan_x - up * tan_y;
+			frustum_edges[2] = forward - right * tan_x + up * tan_y;
+			frustum_edges[3] = forward - right * tan_x - up * tan_y;
+			frustum[0] = PxPlane(cameraEye + forward * near_plane, forward);
+			frustum[1] = PxPlane(cameraEye + forward * far_plane, -forward);
+			frustum[2] = PxPlane(cameraEye, (right + forward * tan_x).getNormalized());
+			frustum[3] = PxPlane(cameraEye, (-right + forward * tan_x).getNormalized());
+			frustum[4] = PxPlane(cameraEye, (up + forward * tan_y).getNormalized());
+			frustum[5] = PxPlane(cameraEye, (-up + forward * tan_y).getNormalized());
+
+			visible_shapes = 0;
+			culled_shapes = 0;
+			state_changes = 0;
+
+			if (backend == GL33_RENDERER)
+				RendererGL3::Camera(cameraEye, cameraDir, fov_y, aspect, near_plane, far_plane);
+		}
+
+		void Backend(RenderBackend value)
+		{
+			backend = value;
+		}
+
+		RenderBackend Backend() { return backend; }
+
+		//the box is not completely outside of any frustum plane (conservative)
+		static bool InFrustum(const PxBounds3& bounds)
+		{
+			PxVec3 center = bounds.getCenter();
+			PxVec3 extents = bounds.getExtents();
+			for (int i = 0; i < 6; i++)
+			{
+				const PxPlane& plane = frustum[i];
+				PxReal radius = PxAbs(plane.n.x) * extents.x + PxAbs(plane.n.y) * extents.y + PxAbs(plane.n.z) * extents.z;
+				if (plane.distance(center) < -radius)
+					return false;
+			}
+			return true;
+		}
+
+		//a shape with these world bounds or its planar shadow can be seen
+		static bool Visible(const PxBounds3& bounds)
+		{
+			if (!frustum_culling)
+				return true;
+
+			if (InFrustum(bounds))
+				return true;
+
+			if (show_shadows && (bounds.maximum.y > 0.f))
+			{
+				//the bounds projected onto the ground along the light direction (as by shadow_matrix)
+				PxReal kx = -shadow_dir.x / shadow_dir.y, kz = -shadow_dir.z / shadow_dir.y;
+				PxReal min_y = PxMax(bounds.minimum.y, 0.f);
+				PxBounds3 shadow(
+					PxVec3(bounds.minimum.x + PxMin(kx * min_y, kx * bounds.maximum.y), 0.f, bounds.minimum.z + PxMin(kz * min_y, kz * bounds.maximum.y)),
+					PxVec3(bounds.maximum.x + PxMax(kx * min_y, kx * bounds.maximum.y), 0.f, bounds.maximum.z + PxMax(kz * min_y, kz * bounds.maximum.y)));
+				if (InFrustum(shadow))
+					return true;
+			}
+
+			return false;
 		}
 
 		void BackgroundColor(const PxVec3& color)
@@ -288,9 +485,247 @@ namespace VisualDebugger
 			background_color = color;
 		}
 
-		void Render(PxActor** actors, const PxU32 numActors)
+		//draw the particles gathered by Render in a single call as round points scaled with the distance,
+		//the positions and colours are streamed into one vertex buffer, the shadows reuse it
+		static void RenderParticleBatch()
+		{
+			const GLsizei count = (GLsizei)particle_vertices.size();
+			const char* base = (const char*)&particle_vertices.front();
+			if (particle_buffer)
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, particle_buffer);
+				GLExt::BufferData(GL_ARRAY_BUFFER, count * sizeof(ParticleVertex), base, GL_STREAM_DRAW);
+				base = 0;
+			}
+
+			//the particle diameter in pixels at a unit distance, divided by the eye distance
+			PxReal size = particle_radius * window_height / tanf(fov_y * PxPi / 360.f);
+			if (GLExt::PointParameters())
+			{
+				const GLfloat attenuation[] = { 0.f, 0.f, 1.f };
+				GLExt::PointParameterfv(GL_POINT_DISTANCE_ATTENUATION, attenuation);
+				GLExt::PointParameterf(GL_POINT_SIZE_MIN, 1.f);
+				glPointSize(size);
+			}
+			else
+				//as seen from 10m
+				glPointSize(PxMax(size / 10.f, 2.f));
+
+			glDisable(GL_LIGHTING);
+			glEnable(GL_POINT_SMOOTH);
+			glEnable(GL_BLEND);
+			glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(ParticleVertex), base);
+
+			if (show_shadows)
+			{
+				glPushMatrix();
+				glMultMatrixf(shadow_matrix);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+				glDrawArrays(GL_POINTS, 0, count);
+				glPopMatrix();
+			}
+
+			glEnableClientState(GL_COLOR_ARRAY);
+			glColorPointer(3, GL_FLOAT, sizeof(ParticleVertex), base + sizeof(PxVec3));
+			glDrawArrays(GL_POINTS, 0, count);
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glDisable(GL_BLEND);
+			glDisable(GL_POINT_SMOOTH);
+			glEnable(GL_LIGHTING);
+			glPointSize(1.f);
+			if (GLExt::PointParameters())
+			{
+				const GLfloat no_attenuation[] = { 1.f, 0.f, 0.f };
+				GLExt::PointParameterfv(GL_POINT_DISTANCE_ATTENUATION, no_attenuation);
+			}
+			if (particle_buffer)
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
+		//queue a shape for the OpenGL 3.3 renderer as unit meshes with a scale
+		static void QueueShape(const PxGeometryHolder& geometry, const PxVec3& color, const PxTransform& pose)
+		{
+			PxMat44 transform(pose);
+			switch (geometry.getType())
+			{
+			case PxGeometryType::ePLANE:
+				RendererGL3::Add(MeshCache::Plane(), transform * PxMat44(PxVec4(10240.f, 1.f, 10240.f, 1.f)), color, false);
+				break;
+			case PxGeometryType::eSPHERE:
+			{
+				PxReal radius = geometry.sphere().radius;
+				RendererGL3::Add(MeshCache::Sphere(render_detail, render_detail), transform * PxMat44(PxVec4(radius, radius, radius, 1.f)), color);
+				break;
+			}
+			case PxGeometryType::eBOX:
+				RendererGL3::Add(MeshCache::Box(), transform * PxMat44(PxVec4(geometry.box().halfExtents, 1.f)), color);
+				break;
+			case PxGeometryType::eCAPSULE:
+			{
+				//two spheres and a cylinder along the X axis
+				PxReal radius = geometry.capsule().radius, half_height = geometry.capsule().halfHeight;
+				PxMat44 sphere_scale(PxVec4(radius, radius, radius, 1.f));
+				RendererGL3::Add(MeshCache::Sphere(render_detail, render_detail), (transform * PxMat44(PxTransform(PxVec3(half_height, 0.f, 0.f)))) * sphere_scale, color);
+				RendererGL3::Add(MeshCache::Sphere(render_detail, render_detail), (transform * PxMat44(PxTransform(PxVec3(-half_height, 0.f, 0.f)))) * sphere_scale, color);
+				RendererGL3::Add(MeshCache::Cylinder(render_detail), (transform * PxMat44(PxTransform(PxQuat(-PxHalfPi, PxVec3(0.f, 0.f, 1.f))))) *
+					PxMat44(PxVec4(radius, half_height, radius, 1.f)), color);
+				break;
+			}
+			case PxGeometryType::eCONVEXMESH:
+				RendererGL3::Add(MeshCache::Get(geometry.convexMesh().convexMesh), transform, color);
+				break;
+			case PxGeometryType::eTRIANGLEMESH:
+				RendererGL3::Add(MeshCache::Get(geometry.triangleMesh().triangleMesh), transform, color);
+				break;
+			default:
+				break;
+			}
+		}
+
+		static void SetLighting(bool value)
+		{
+			if (value == lighting_state)
+				return;
+			if (value)
+				glEnable(GL_LIGHTING);
+			else
+				glDisable(GL_LIGHTING);
+			lighting_state = value;
+			state_changes++;
+		}
+
+		static void SetColor(const PxVec3& color)
+		{
+			if (color_valid && (color == color_state))
+				return;
+			glColor4f(color.x, color.y, color.z, 1.f);
+			color_state = color;
+			color_valid = true;
+			state_changes++;
+		}
+
+		//queue a shape for the fixed-function renderer
+		static void QueueDraw(const PxGeometryHolder& geometry, const PxVec3& color, const PxMat44& transform)
+		{
+			DrawItem item;
+			item.type = geometry.getType();
+			item.pass = (item.type == PxGeometryType::ePLANE) ? UNLIT_PASS : LIT_PASS;
+			if (item.type == PxGeometryType::eCONVEXMESH)
+				item.mesh = &MeshCache::Get(geometry.convexMesh().convexMesh);
+			else if (item.type == PxGeometryType::eTRIANGLEMESH)
+				item.mesh = &MeshCache::Get(geometry.triangleMesh().triangleMesh);
+			else
+				item.mesh = 0;
+			item.packed_color = ((PxU32)(PxClamp(color.x, 0.f, 1.f) * 255.f) << 16) |
+				((PxU32)(PxClamp(color.y, 0.f, 1.f) * 255.f) << 8) | (PxU32)(PxClamp(color.z, 0.f, 1.f) * 255.f);
+			item.color = color;
+			item.geometry = geometry;
+			item.transform = transform;
+			draw_queue.push_back(item);
+		}
+
+		//draw the queued items from begin to end with the current colour and lighting,
+		//runs of the same mesh (and colour unless it is a shadow) are drawn with one instanced call
+		static void DrawItems(PxU32 begin, PxU32 end, bool shadow)
+		{
+			const RenderMesh* last_mesh = 0;
+			for (PxU32 i = begin, j; i < end; i = j)
+			{
+				const DrawItem& item = draw_queue[i];
+				if (!shadow)
+					SetColor(item.color);
+				j = i + 1;
+
+				if (item.mesh)
+				{
+					if (item.mesh != last_mesh)
+					{
+						last_mesh = item.mesh;
+						state_changes++;
+					}
+
+					if (Instancing::Enabled())
+					{
+						for (; (j < end) && (draw_queue[j].mesh == item.mesh) && (shadow || (draw_queue[j].packed_color == item.packed_color)); j++);
+						instance_transforms.clear();
+						for (PxU32 k = i; k < j; k++)
+							instance_transforms.push_back(draw_queue[k].transform);
+						Instancing::Instances(&instance_transforms.front(), j - i);
+						Instancing::Draw(*item.mesh, j - i, !shadow);
+						continue;
+					}
+				}
+
+				glPushMatrix();
+				glMultMatrixf((float*)&item.transform);
+				if (item.mesh)
+					MeshCache::Draw(*item.mesh);
+				else
+					RenderGeometry(item.geometry);
+				glPopMatrix();
+			}
+		}
+
+		//sort the queue and draw it: all lit geometry, then all shadows with the lighting turned off once
+		static void SubmitDrawQueue()
+		{
+			if (draw_queue.empty())
+				return;
+
+			std::sort(draw_queue.begin(), draw_queue.end());
+
+			//the lighting is on between the draws of the renderer, the colour is unknown
+			lighting_state = true;
+			color_valid = false;
+
+			PxU32 first_lit = 0;
+			for (; (first_lit < draw_queue.size()) && (draw_queue[first_lit].pass == UNLIT_PASS); first_lit++);
+
+			SetLighting(false);
+			DrawItems(0, first_lit, false);
+			SetLighting(true);
+			DrawItems(first_lit, (PxU32)draw_queue.size(), false);
+
+			//the ground casts no shadow
+			if (show_shadows && (first_lit < draw_queue.size()))
+			{
+				SetLighting(false);
+				SetColor(shadow_color);
+				glPushMatrix();
+				glMultMatrixf(shadow_matrix);
+				DrawItems(first_lit, (PxU32)draw_queue.size(), true);
+				glPopMatrix();
+			}
+
+			SetLighting(true);
+			draw_queue.clear();
+		}
+
+		//static and sleeping actors are drawn from the static batch (particles stay points)
+		static bool Batched(const PxRigidActor* actor, const std::vector<PxShape*>& shapes)
+		{
+			if (!static_batching || shapes.empty())
+				return false;
+			if ((actor->getType() != PxActorType::eRIGID_STATIC) && !StaticBatch::Asleep(actor))
+				return false;
+			for (PxU32 i = 0; i < shapes.size(); i++)
+				if (shapes[i]->userData && ((UserData*)shapes[i]->userData)->particle)
+					return false;
+			return true;
+		}
+
+		void Render(PxActor** actors, const PxU32 numActors, const PxTransform* poses)
 		{
-			PxVec3 shadow_color = default_color * 0.9;
+			//drop the meshes and actors released since the last frame before any lookup
+			MeshCache::Flush();
+			StaticBatch::Flush();
+			particle_vertices.clear();
+			PxU32 rigid_actors = 0;
+
 			for (PxU32 i = 0; i < numActors; i++) {
 #if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
 				if (actors[i]->isCloth()) {
@@ -307,12 +742,44 @@ namespace VisualDebugger
 					PxRigidActor* rigid_actor = (PxRigidActor*)actors[i];
 					std::vector<PxShape*> shapes(rigid_actor->getNbShapes());
 					rigid_actor->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
+					rigid_actors++;
+
+					if (Batched(rigid_actor, shapes))
+					{
+						//the shadows are the colour of the ground
+						for (PxU32 j = 0; j < shapes.size(); j++)
+							if ((shapes[j]->getGeometryType() == PxGeometryType::ePLANE) && shapes[j]->userData)
+								shadow_color = *((UserData*)shapes[j]->userData)->color * 0.9f;
+						StaticBatch::Add(rigid_actor, poses ? poses[i] : rigid_actor->getGlobalPose(), &shapes.front(), (PxU32)shapes.size());
+						continue;
+					}
 
 					for (PxU32 j = 0; j < shapes.size(); j++)
 					{
 						const PxShape* shape = shapes[j];
-						PxTransform pose = PxShapeExt::getGlobalPose(*shape, *shape->getActor());
+						PxTransform pose = poses ? poses[i] * shape->getLocalPose() : PxShapeExt::getGlobalPose(*shape, *shape->getActor());
 						PxGeometryHolder h = shape->getGeometry();
+
+						//skip shapes outside of the view frustum (planes are infinite)
+						if (h.getType() != PxGeometryType::ePLANE)
+						{
+							if (!Visible(PxGeometryQuery::getWorldBounds(h.any(), pose)))
+							{
+								culled_shapes++;
+								continue;
+							}
+							visible_shapes++;
+						}
+
+						//particles are drawn together after all other shapes
+						if (shape->userData && ((UserData*)shape->userData)->particle && (h.getType() == PxGeometryType::eSPHERE))
+						{
+							ParticleVertex vertex = { pose.p, *((UserData*)shape->userData)->color };
+							particle_vertices.push_back(vertex);
+							particle_radius = h.sphere().radius;
+							continue;
+						}
+
 						//move the plane slightly down to avoid visual artefacts
 						if (h.getType() == PxGeometryType::ePLANE)
 						{
@@ -321,10 +788,6 @@ namespace VisualDebugger
 						}
 
 						PxMat44 shapePose(pose);
-						// render object
-						glPushMatrix();
-						glMultMatrixf((float*)&shapePose);
-
 						PxVec3 shape_color = default_color;
 
 						if (shape->userData)
@@ -336,39 +799,136 @@ namespace VisualDebugger
 							}
 						}
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glDisable(GL_LIGHTING);
+						//all shapes are drawn together after the loop
+						if (backend == GL33_RENDERER)
+						{
+							QueueShape(h, shape_color, pose);
+							continue;
+						}
+
+						//drawn in sorted order after the loop
+						QueueDraw(h, shape_color, shapePose);
+					}
+				}
+			}
 
-						glColor4f(shape_color.x, shape_color.y, shape_color.z, 1.f);
+			//the GL 3.3 shapes stay queued with the cylinders until FlushShapes
+			if (backend != GL33_RENDERER)
+				SubmitDrawQueue();
 
-						RenderGeometry(h);
+			//only calls with rigid actors update the batch (the cloths are drawn separately)
+			if (rigid_actors && static_batching)
+			{
+				StaticBatch::Settings settings = { (PxU32)render_detail, default_color };
+				StaticBatch::Draw(settings, show_shadows, shadow_matrix, shadow_color);
+			}
 
-						if (h.getType() == PxGeometryType::ePLANE)
-							glEnable(GL_LIGHTING);
+			if (particle_vertices.size())
+				RenderParticleBatch();
+		}
 
-						glPopMatrix();
+		void RenderCylinder(const PxTransform& pose, PxReal radius, PxReal halfHeight, const PxVec3& color)
+		{
+			if (!Visible(PxBounds3::basisExtent(pose.p, PxMat33(pose.q), PxVec3(radius, halfHeight, radius))))
+			{
+				culled_shapes++;
+				return;
+			}
+			visible_shapes++;
 
-						if (show_shadows && (h.getType() != PxGeometryType::ePLANE))
-						{
-							const PxVec3 shadowDir(-0.7071067f, -0.7071067f, -0.7071067f);
-							const PxReal shadowMat[] = { 1,0,0,0, -shadowDir.x / shadowDir.y,0,-shadowDir.z / shadowDir.y,0, 0,0,1,0, 0,0,0,1 };
-							glPushMatrix();
-							glMultMatrixf(shadowMat);
-							glMultMatrixf((float*)&shapePose);
-							glDisable(GL_LIGHTING);
-							glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
-							RenderGeometry(h);
-							glEnable(GL_LIGHTING);
-							glPopMatrix();
-						}
-					}
-				}
+			//fewer slices when the cylinder covers fewer pixels on the screen
+			PxReal distance = PxMax((pose.p - camera_eye).magnitude(), near_plane);
+			PxReal pixels = radius * window_height / (tanf(fov_y * PxPi / 360.f) * distance);
+			PxU32 slices = (pixels > 64.f) ? 64 : (pixels > 16.f) ? 32 : (pixels > 4.f) ? 16 : 8;
 
-				}
-				}
+			PxMat44 shapePose(pose);
+			if (backend == GL33_RENDERER)
+			{
+				//the smooth cylinder has no shadow, the convex hull under it has one
+				RendererGL3::Add(MeshCache::Cylinder(slices), shapePose * PxMat44(PxVec4(radius, halfHeight, radius, 1.f)), color, true, false);
+				return;
+			}
+
+			glColor4f(color.x, color.y, color.z, 1.f);
+			state_changes++;
+
+			glPushMatrix();
+			glMultMatrixf((float*)&shapePose);
+			glScalef(radius, halfHeight, radius);
+			//the scale is not uniform
+			glEnable(GL_NORMALIZE);
+			MeshCache::Draw(MeshCache::Cylinder(slices));
+			glDisable(GL_NORMALIZE);
+			glPopMatrix();
+		}
+
+		//unlit points of a single color
+		static void BeginPoints(const PxVec3& color, PxReal size)
+		{
+			glDisable(GL_LIGHTING);
+			glColor4f(color.x, color.y, color.z, 1.f);
+			glPointSize(size);
+			glEnableClientState(GL_VERTEX_ARRAY);
+		}
+
+		static void EndPoints()
+		{
+			glDisableClientState(GL_VERTEX_ARRAY);
+			glPointSize(1.f);
+			glEnable(GL_LIGHTING);
+		}
+
+		void RenderPoints(const PxVec3* points, PxU32 numPoints, const PxVec3& color, PxReal size)
+		{
+			if (!numPoints)
+				return;
+
+			BeginPoints(color, size);
+			glVertexPointer(3, GL_FLOAT, sizeof(PxVec3), points);
+			glDrawArrays(GL_POINTS, 0, numPoints);
+			EndPoints();
+		}
+
+		void RenderParticles(PxParticleBase* particles, const PxVec3& color, PxReal size)
+		{
+			PxParticleReadData* data = particles->lockParticleReadData(PxDataAccessFlag::eREADABLE);
+			if (!data)
+				return;
+
+			if (data->nbValidParticles)
+			{
+				//the valid particles are marked in a bitmap over the index range,
+				//their positions are drawn in place from the read data buffer
+				std::vector<GLuint> indices;
+				indices.reserve(data->nbValidParticles);
+				for (PxU32 word = 0; word <= (data->validParticleRange - 1) >> 5; word++)
+					for (PxU32 bits = data->validParticleBitmap[word], index = word << 5; bits; bits >>= 1, index++)
+						if (bits & 1)
+							indices.push_back(index);
+
+				BeginPoints(color, size);
+				glVertexPointer(3, GL_FLOAT, data->positionBuffer.stride(), data->positionBuffer.ptr());
+				glDrawElements(GL_POINTS, (GLsizei)indices.size(), GL_UNSIGNED_INT, &indices[0]);
+				EndPoints();
+			}
+
+			data->unlock();
+		}
+
+		void FlushShapes()
+		{
+			if (backend != GL33_RENDERER)
+				return;
+
+			RendererGL3::Flush(show_shadows, shadow_matrix, shadow_color);
+			//every draw binds the vertex array of its mesh
+			state_changes += RendererGL3::DrawCalls();
+		}
 
 		void Finish()
 		{
+			//nothing is queued if FlushShapes was called before the overlays
+			FlushShapes();
 			glutSwapBuffers();
 		}
 
@@ -384,136 +944,215 @@ namespace VisualDebugger
 
 		bool ShowShadows() { return show_shadows; }
 
-		void RenderBuffer(float* pVertList, float* pColorList, int type, int num)
+		void FrustumCulling(bool value)
+		{
+			frustum_culling = value;
+		}
+
+		bool FrustumCulling() { return frustum_culling; }
+
+		PxBounds3 FrustumBounds(PxReal distance)
+		{
+			//the frustum is the convex hull of the eye and its far corners
+			PxBounds3 bounds(camera_eye, camera_eye);
+			for (int i = 0; i < 4; i++)
+				bounds.include(camera_eye + frustum_edges[i] * distance);
+			return bounds;
+		}
+
+		PxU32 VisibleShapes() { return visible_shapes; }
+
+		PxU32 CulledShapes() { return culled_shapes; }
+
+		PxU32 StateChanges() { return state_changes; }
+
+		void StaticBatching(bool value)
+		{
+			static_batching = value;
+		}
+
+		bool StaticBatching() { return static_batching; }
+
+		PxU32 BatchedShapes() { return static_batching ? StaticBatch::Shapes() : 0; }
+
+		void Wake(PxActor* const* actors, PxU32 count)
+		{
+			StaticBatch::Wake(actors, count);
+		}
+
+		void Sleep(PxActor* const* actors, PxU32 count)
+		{
+			StaticBatch::Sleep(actors, count);
+		}
+
+		//debug vertices as packed by PhysX: a position followed by a 0xAARRGGBB colour
+		static void RenderDebugVertices(const void* data, PxU32 count, GLenum mode)
 		{
+			const GLsizei stride = sizeof(PxVec3) + sizeof(PxU32);
+			const char* base = (const char*)data;
+			if (debug_buffer)
+			{
+				//the buffer only grows, smaller frames overwrite its start
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, debug_buffer);
+				GLExt::GLsizeiptr size = count * stride;
+				if (size > debug_buffer_size)
+				{
+					GLExt::BufferData(GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW);
+					debug_buffer_size = size;
+				}
+				else
+					GLExt::BufferSubData(GL_ARRAY_BUFFER, 0, size, data);
+				base = 0;
+			}
+
 			glEnableClientState(GL_VERTEX_ARRAY);
-			glVertexPointer(3, GL_FLOAT, 0, pVertList);
 			glEnableClientState(GL_COLOR_ARRAY);
-			glColorPointer(4, GL_FLOAT, 0, pColorList);
-			glDrawArrays(type, 0, num);
+			glVertexPointer(3, GL_FLOAT, stride, base);
+			//the colours are read in place as BGRA bytes (little endian), otherwise R and B are swapped into a separate array
+			if (GLExt::VertexArrayBGRA())
+				glColorPointer(GL_BGRA, GL_UNSIGNED_BYTE, stride, base + sizeof(PxVec3));
+			else
+			{
+				if (debug_colors.size() < count)
+					debug_colors.resize(count);
+				const char* colors = (const char*)data + sizeof(PxVec3);
+				for (PxU32 i = 0; i < count; i++)
+				{
+					PxU32 color = *(const PxU32*)(colors + i * stride);
+					debug_colors[i] = 0xff000000 | (color & 0x0000ff00) | ((color >> 16) & 0xff) | ((color & 0xff) << 16);
+				}
+				if (debug_buffer)
+					GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+				glColorPointer(4, GL_UNSIGNED_BYTE, 0, &debug_colors.front());
+			}
+
+			glDrawArrays(mode, 0, count);
 			glDisableClientState(GL_COLOR_ARRAY);
 			glDisableClientState(GL_VERTEX_ARRAY);
+			if (debug_buffer)
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
 		}
 
+		//points, lines and triangles are arrays of these vertices
+		static_assert(sizeof(PxDebugPoint) == sizeof(PxVec3) + sizeof(PxU32), "unexpected PxDebugPoint layout");
+		static_assert(sizeof(PxDebugLine) == 2 * (sizeof(PxVec3) + sizeof(PxU32)), "unexpected PxDebugLine layout");
+		static_assert(sizeof(PxDebugTriangle) == 3 * (sizeof(PxVec3) + sizeof(PxU32)), "unexpected PxDebugTriangle layout");
+
 		///Render PxRenderBuffer
 		///TODO: support text data
 		void Render(const PxRenderBuffer& data, PxReal line_width)
 		{
 			glLineWidth(line_width);
 
-			//render points
+			if (data.getNbPoints())
+				RenderDebugVertices(data.getPoints(), data.getNbPoints(), GL_POINTS);
 
-			unsigned int NbPoints = data.getNbPoints();
-			if (NbPoints)
-			{
-				std::vector<float> pVertList(NbPoints * 3);
-				std::vector<float> pColorList(NbPoints * 4);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const physx::PxDebugPoint* Points = data.getPoints();
-				while (NbPoints--)
-				{
-					pVertList[vertIndex++] = Points->pos.x;
-					pVertList[vertIndex++] = Points->pos.y;
-					pVertList[vertIndex++] = Points->pos.z;
-					pColorList[colorIndex++] = (float)((Points->color >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Points->color >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Points->color & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-					Points++;
-				}
+			if (data.getNbLines())
+				RenderDebugVertices(data.getLines(), data.getNbLines() * 2, GL_LINES);
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_POINTS, data.getNbPoints());
-			}
+			if (data.getNbTriangles())
+				RenderDebugVertices(data.getTriangles(), data.getNbTriangles() * 3, GL_TRIANGLES);
 
-			//render lines
+			//TODO: render texts ?
+		}
 
-			unsigned int NbLines = data.getNbLines();
-			if (NbLines)
-			{
-				std::vector<float> pVertList(NbLines * 3 * 2);
-				std::vector<float> pColorList(NbLines * 4 * 2);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugLine* Lines = data.getLines();
-				while (NbLines--)
-				{
-					pVertList[vertIndex++] = Lines->pos0.x;
-					pVertList[vertIndex++] = Lines->pos0.y;
-					pVertList[vertIndex++] = Lines->pos0.z;
-					pColorList[colorIndex++] = (float)((Lines->color0 >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Lines->color0 >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Lines->color0 & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pVertList[vertIndex++] = Lines->pos1.x;
-					pVertList[vertIndex++] = Lines->pos1.y;
-					pVertList[vertIndex++] = Lines->pos1.z;
-					pColorList[colorIndex++] = (float)((Lines->color1 >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Lines->color1 >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Lines->color1 & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Lines++;
-				}
+		void RenderText(const std::string& text, const physx::PxVec2& location,
+			const PxVec3& color, PxReal size)
+		{
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+			GLFontRenderer::setScreenResolution(window_width, window_height);
+			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+		}
 
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_LINES, data.getNbLines() * 2);
-			}
+		void TessellateText(const std::string& text, const physx::PxVec2& location, PxReal size, std::vector<float>& vertices)
+		{
+			GLFontRenderer::setScreenResolution(window_width, window_height);
+			GLFontRenderer::tessellate(location.x, location.y, size, text.c_str(), vertices);
+		}
+
+		TextGeometry::~TextGeometry()
+		{
+			if (buffer && GLExt::DeleteBuffers)
+				GLExt::DeleteBuffers(1, &buffer);
+		}
 
-			//render triangles
+		void RenderText(TextGeometry& geometry, const PxVec3& color)
+		{
+			if (geometry.vertices.empty())
+				return;
 
-			unsigned int NbTris = data.getNbTriangles();
-			if (NbTris)
+			const float* base = &geometry.vertices.front();
+			if (GLExt::BufferObjects())
 			{
-				std::vector<float> pVertList(NbTris * 3 * 3);
-				std::vector<float> pColorList(NbTris * 4 * 3);
-				int vertIndex = 0;
-				int colorIndex = 0;
-				const PxDebugTriangle* Triangles = data.getTriangles();
-				while (NbTris--)
+				if (!geometry.buffer)
+					GLExt::GenBuffers(1, &geometry.buffer);
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, geometry.buffer);
+				//a longer text is uploaded whole, otherwise only the changed range
+				if (geometry.vertices.size() > geometry.capacity)
 				{
-					pVertList[vertIndex++] = Triangles->pos0.x;
-					pVertList[vertIndex++] = Triangles->pos0.y;
-					pVertList[vertIndex++] = Triangles->pos0.z;
-
-					pVertList[vertIndex++] = Triangles->pos1.x;
-					pVertList[vertIndex++] = Triangles->pos1.y;
-					pVertList[vertIndex++] = Triangles->pos1.z;
-
-					pVertList[vertIndex++] = Triangles->pos2.x;
-					pVertList[vertIndex++] = Triangles->pos2.y;
-					pVertList[vertIndex++] = Triangles->pos2.z;
-
-					pColorList[colorIndex++] = (float)((Triangles->color0 >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color0 >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color0 & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color1 >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color1 >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color1 & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					pColorList[colorIndex++] = (float)((Triangles->color2 >> 16) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)((Triangles->color2 >> 8) & 0xff) / 255.f;
-					pColorList[colorIndex++] = (float)(Triangles->color2 & 0xff) / 255.f;
-					pColorList[colorIndex++] = 1.f;
-
-					Triangles++;
+					GLExt::BufferData(GL_ARRAY_BUFFER, geometry.vertices.size() * sizeof(float), base, GL_DYNAMIC_DRAW);
+					geometry.capacity = geometry.vertices.size();
 				}
-
-				RenderBuffer(&pVertList.front(), &pColorList.front(), GL_TRIANGLES, data.getNbTriangles() * 3);
+				else if (geometry.changed_begin < geometry.changed_end)
+				{
+					size_t end = PxMin(geometry.changed_end, geometry.vertices.size());
+					if (geometry.changed_begin < end)
+						GLExt::BufferSubData(GL_ARRAY_BUFFER, geometry.changed_begin * sizeof(float),
+							(end - geometry.changed_begin) * sizeof(float), base + geometry.changed_begin);
+				}
+				geometry.changed_begin = geometry.changed_end = 0;
+				base = 0;
 			}
 
-			//TODO: render texts ?
+			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
+			GLFontRenderer::setScreenResolution(window_width, window_height);
+			GLFontRenderer::draw(base, (unsigned int)geometry.vertices.size() / 4);
+
+			if (geometry.buffer)
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
 		}
 
-		void RenderText(const std::string& text, const physx::PxVec2& location,
-			const PxVec3& color, PxReal size)
+		void RenderGraph(const float* values, PxU32 count, PxReal max_value, const PxVec2& location, const PxVec2& size, const PxVec3& color)
 		{
-			GLFontRenderer::setColor(color.x, color.y, color.z, 1.f);
-			GLFontRenderer::setScreenResolution(glutGet(GLUT_WINDOW_WIDTH), glutGet(GLUT_WINDOW_HEIGHT));
-			GLFontRenderer::print(location.x, location.y, size, text.c_str());
+			if ((count < 2) || (max_value <= 0.f))
+				return;
+
+			//the frame first, then one line strip through all samples
+			graph_vertices.resize(count + 4);
+			graph_vertices[0] = location;
+			graph_vertices[1] = PxVec2(location.x + size.x, location.y);
+			graph_vertices[2] = location + size;
+			graph_vertices[3] = PxVec2(location.x, location.y + size.y);
+			for (PxU32 i = 0; i < count; i++)
+				graph_vertices[i + 4] = PxVec2(location.x + size.x * i / (count - 1), location.y + size.y * PxMin(values[i] / max_value, 1.f));
+
+			glDisable(GL_LIGHTING);
+			glDisable(GL_DEPTH_TEST);
+			glMatrixMode(GL_PROJECTION);
+			glPushMatrix();
+			glLoadIdentity();
+			glOrtho(0, 1, 0, 1, -1, 1);
+			glMatrixMode(GL_MODELVIEW);
+			glPushMatrix();
+			glLoadIdentity();
+
+			glColor4f(color.x, color.y, color.z, 1.f);
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glVertexPointer(2, GL_FLOAT, sizeof(PxVec2), &graph_vertices.front());
+			glDrawArrays(GL_LINE_LOOP, 0, 4);
+			glDrawArrays(GL_LINE_STRIP, 4, count);
+			glDisableClientState(GL_VERTEX_ARRAY);
+
+			glMatrixMode(GL_PROJECTION);
+			glPopMatrix();
+			glMatrixMode(GL_MODELVIEW);
+			glPopMatrix();
+			glEnable(GL_DEPTH_TEST);
+			glEnable(GL_LIGHTING);
 		}
+
+		int WindowWidth() { return window_width; }
+
+		int WindowHeight() { return window_height; }
 			}
 		}
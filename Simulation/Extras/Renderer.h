@@ -4,6 +4,8 @@
 #include "GLFontRenderer.h"
 #include <GL/glut.h>
 #include <string>
+#include <cstring>
+#include <vector>
 
 namespace VisualDebugger
 {
@@ -11,6 +13,31 @@ namespace VisualDebugger
 	{
 		using namespace physx;
 
+		///How the shapes are drawn
+		enum RenderBackend
+		{
+			FIXED_FUNCTION_RENDERER,
+			GL33_RENDERER
+		};
+
+		///Parse a backend name: "fixed" or "gl33"
+		inline bool RenderBackendByName(const char* name, RenderBackend& backend)
+		{
+			if (!strcmp(name, "fixed"))
+				backend = FIXED_FUNCTION_RENDERER;
+			else if (!strcmp(name, "gl33"))
+				backend = GL33_RENDERER;
+			else
+				return false;
+			return true;
+		}
+
+		///Select the backend (before Init), OpenGL 3.3 falls back to the fixed-function one if it is not available
+		void Backend(RenderBackend value);
+
+		///Get the backend in use
+		RenderBackend Backend();
+
 		///Init rendering window
 		void InitWindow(const char *name, int width, int height);
 
@@ -21,7 +48,22 @@ namespace VisualDebugger
 		void Start(const PxVec3& cameraEye, const PxVec3& cameraDir);
 
 		///Render actors
-		void Render(PxActor** actors, const PxU32 numActors);
+		///poses (optional) - per-actor global poses overriding the simulated ones (e.g. interpolated)
+		void Render(PxActor** actors, const PxU32 numActors, const PxTransform* poses=0);
+
+		///Render a smooth cylinder aligned with the Y axis (e.g. over a convex RC_Cylinder hull),
+		///the number of slices depends on its size on the screen
+		void RenderCylinder(const PxTransform& pose, PxReal radius, PxReal halfHeight, const PxVec3& color);
+
+		///Draw the shapes queued by Render and RenderCylinder (the GL 3.3 backend draws all shapes of a frame at once),
+		///call it after the last shape and before the text and other overlays
+		void FlushShapes();
+
+		///Render points of a single color (e.g. particles), size in pixels
+		void RenderPoints(const PxVec3* points, PxU32 numPoints, const PxVec3& color, PxReal size);
+
+		///Render the particles of a PhysX particle system (the simulation must not be running), size in pixels
+		void RenderParticles(PxParticleBase* particles, const PxVec3& color, PxReal size);
 
 		///Render debug information
 		void Render(const PxRenderBuffer& data, PxReal line_width=1.f);
@@ -30,6 +72,59 @@ namespace VisualDebugger
 		void RenderText(const std::string& text, const physx::PxVec2& location, 
 			const PxVec3& color, PxReal size);
 
+		///Glyph quads of a block of text (x, y, u, v per vertex in pixels) in a buffer object,
+		///only the range marked as changed is uploaded again
+		struct TextGeometry
+		{
+			std::vector<float> vertices;
+			GLuint buffer;
+			//floats allocated in the buffer
+			size_t capacity;
+			//floats changed since the last upload (none if begin == end)
+			size_t changed_begin, changed_end;
+
+			TextGeometry() : buffer(0), capacity(0), changed_begin(0), changed_end(0) {}
+
+			///Delete the buffer (the window must still exist)
+			~TextGeometry();
+
+			///Mark a range of the vertices (in floats) to be uploaded again
+			void Changed(size_t begin, size_t end)
+			{
+				if (begin >= end)
+					return;
+				if (changed_begin == changed_end)
+				{
+					changed_begin = begin;
+					changed_end = end;
+					return;
+				}
+				changed_begin = (begin < changed_begin) ? begin : changed_begin;
+				changed_end = (end > changed_end) ? end : changed_end;
+			}
+
+		private:
+			//owns the buffer, not copied
+			TextGeometry(const TextGeometry&);
+			TextGeometry& operator=(const TextGeometry&);
+		};
+
+		///Append the glyph quads of a text for the current window size
+		void TessellateText(const std::string& text, const physx::PxVec2& location, PxReal size, std::vector<float>& vertices);
+
+		///Render tessellated text with a single call
+		void RenderText(TextGeometry& geometry, const PxVec3& color);
+
+		///Render a line graph of the values over a frame in window coordinates [0..1] (e.g. frame times),
+		///the values are scaled by max_value and clipped to the top of the frame
+		void RenderGraph(const float* values, PxU32 count, PxReal max_value, const PxVec2& location, const PxVec2& size, const PxVec3& color);
+
+		///Window width in pixels
+		int WindowWidth();
+
+		///Window height in pixels
+		int WindowHeight();
+
 		///Set background color
 		void BackgroundColor(const PxVec3& background_color);
 
@@ -44,5 +139,38 @@ namespace VisualDebugger
 
 		///Get show shadows
 		bool ShowShadows();
+
+		///Skip shapes outside of the view frustum (shapes with a visible shadow are kept)
+		void FrustumCulling(bool value);
+
+		///Get frustum culling
+		bool FrustumCulling();
+
+		///Bounds of the view frustum of the current frame cut at a distance from the eye (e.g. to cull debug data)
+		PxBounds3 FrustumBounds(PxReal distance);
+
+		///Number of shapes rendered since Start
+		PxU32 VisibleShapes();
+
+		///Number of shapes culled since Start
+		PxU32 CulledShapes();
+
+		///Number of lighting, colour and mesh changes made to draw the shapes since Start
+		PxU32 StateChanges();
+
+		///Draw static and sleeping actors from one baked vertex buffer, rebuilt when one of them wakes up, moves or is removed
+		void StaticBatching(bool value);
+
+		///Get static batching
+		bool StaticBatching();
+
+		///Number of shapes drawn from the static batch
+		PxU32 BatchedShapes();
+
+		///Actors woken up by the simulation, they leave the static batch
+		void Wake(PxActor* const* actors, PxU32 count);
+
+		///Actors put to sleep by the simulation, they join the static batch
+		void Sleep(PxActor* const* actors, PxU32 count);
 	}
 }
\ No newline at end of file
@@ -0,0 +1,288 @@
+#include "RendererGL3.h"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+namespace VisualDebugger
+{
+	namespace RendererGL3
+	{
+		using namespace std;
+
+		static const GLchar* vertex_source =
+			"#version 330 core\n"
+			"layout(std140) uniform Camera\n"
+			"{\n"
+			"	mat4 view_projection;\n"
+			"	mat4 shadow_projection;\n"
+			"	vec4 light_direction;\n"
+			"	vec4 ambient;\n"
+			"	vec4 diffuse;\n"
+			"	vec4 shadow_color;\n"
+			"};\n"
+			//five texels per object: the transform columns and the colour (alpha 0 - unlit)
+			"uniform samplerBuffer objects;\n"
+			"uniform int first_object;\n"
+			"uniform int shadow;\n"
+			"layout(location = 0) in vec3 position;\n"
+			"layout(location = 1) in vec3 normal;\n"
+			"out vec4 color;\n"
+			"void main()\n"
+			"{\n"
+			"	int base = (first_object + gl_InstanceID) * 5;\n"
+			"	mat4 model = mat4(texelFetch(objects, base), texelFetch(objects, base + 1), texelFetch(objects, base + 2), texelFetch(objects, base + 3));\n"
+			"	vec4 object_color = texelFetch(objects, base + 4);\n"
+			"	vec4 world = model * vec4(position, 1.0);\n"
+			"	if (shadow != 0)\n"
+			"	{\n"
+			"		gl_Position = shadow_projection * world;\n"
+			"		color = shadow_color;\n"
+			"		return;\n"
+			"	}\n"
+			"	gl_Position = view_projection * world;\n"
+			"	if (object_color.a == 0.0)\n"
+			"	{\n"
+			"		color = vec4(object_color.rgb, 1.0);\n"
+			"		return;\n"
+			"	}\n"
+			//the inverse transpose of a rotation with a scale divides by the squared scale
+			"	mat3 basis = mat3(model);\n"
+			"	vec3 scale2 = vec3(dot(basis[0], basis[0]), dot(basis[1], basis[1]), dot(basis[2], basis[2]));\n"
+			"	vec3 world_normal = normalize(basis * (normal / scale2));\n"
+			"	float intensity = max(dot(world_normal, light_direction.xyz), 0.0);\n"
+			"	color = vec4(object_color.rgb * (ambient.rgb + diffuse.rgb * intensity), 1.0);\n"
+			"}\n";
+
+		static const GLchar* fragment_source =
+			"#version 330 core\n"
+			"in vec4 color;\n"
+			"out vec4 fragment;\n"
+			"void main()\n"
+			"{\n"
+			"	fragment = color;\n"
+			"}\n";
+
+		//uniform block layout (std140)
+		struct CameraBlock
+		{
+			PxMat44 view_projection;
+			PxMat44 shadow_projection;
+			PxVec4 light_direction;
+			PxVec4 ambient;
+			PxVec4 diffuse;
+			PxVec4 shadow_color;
+		};
+
+		struct ObjectData
+		{
+			PxMat44 transform;
+			PxVec4 color;
+		};
+
+		struct DrawItem
+		{
+			const RenderMesh* mesh;
+			ObjectData object;
+			bool shadow;
+
+			bool operator<(const DrawItem& item) const { return (mesh < item.mesh) || ((mesh == item.mesh) && (shadow < item.shadow)); }
+		};
+
+		static GLuint program = 0;
+		static GLint first_object_uniform = -1;
+		static GLint shadow_uniform = -1;
+		static GLuint camera_buffer = 0;
+		static GLuint object_buffer = 0;
+		static GLuint object_texture = 0;
+
+		static CameraBlock camera;
+		static vector<DrawItem> items;
+		static vector<ObjectData> objects;
+		static PxU32 draw_calls = 0;
+
+		static GLuint Compile(GLenum type, const GLchar* source)
+		{
+			GLuint shader = GLExt::CreateShader(type);
+			GLExt::ShaderSource(shader, 1, &source, 0);
+			GLExt::CompileShader(shader);
+
+			GLint status = 0;
+			GLExt::GetShaderiv(shader, GL_COMPILE_STATUS, &status);
+			if (!status)
+			{
+				GLchar log[1024];
+				GLExt::GetShaderInfoLog(shader, sizeof(log), 0, log);
+				cerr << "OpenGL 3.3 renderer shader error: " << log << endl;
+				GLExt::DeleteShader(shader);
+				return 0;
+			}
+			return shader;
+		}
+
+		bool Init()
+		{
+			if (program)
+				return true;
+
+			if (!GLExt::Version33())
+				return false;
+
+			GLuint vertex_shader = Compile(GL_VERTEX_SHADER, vertex_source);
+			GLuint fragment_shader = Compile(GL_FRAGMENT_SHADER, fragment_source);
+			if (vertex_shader && fragment_shader)
+			{
+				program = GLExt::CreateProgram();
+				GLExt::AttachShader(program, vertex_shader);
+				GLExt::AttachShader(program, fragment_shader);
+				GLExt::LinkProgram(program);
+
+				GLint status = 0;
+				GLExt::GetProgramiv(program, GL_LINK_STATUS, &status);
+				if (!status)
+				{
+					GLExt::DeleteProgram(program);
+					program = 0;
+				}
+			}
+			if (vertex_shader)
+				GLExt::DeleteShader(vertex_shader);
+			if (fragment_shader)
+				GLExt::DeleteShader(fragment_shader);
+
+			if (!program)
+				return false;
+
+			//the camera block at binding 0 and the object texture at unit 1 (unit 0 is used by the font)
+			GLExt::UniformBlockBinding(program, GLExt::GetUniformBlockIndex(program, "Camera"), 0);
+			GLExt::UseProgram(program);
+			GLExt::Uniform1i(GLExt::GetUniformLocation(program, "objects"), 1);
+			GLExt::UseProgram(0);
+			first_object_uniform = GLExt::GetUniformLocation(program, "first_object");
+			shadow_uniform = GLExt::GetUniformLocation(program, "shadow");
+
+			GLExt::GenBuffers(1, &camera_buffer);
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, camera_buffer);
+			GLExt::BufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), 0, GL_STREAM_DRAW);
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+
+			GLExt::GenBuffers(1, &object_buffer);
+			glGenTextures(1, &object_texture);
+
+			return true;
+		}
+
+		void Camera(const PxVec3& eye, const PxVec3& dir, PxReal fov_y, PxReal aspect, PxReal near_plane, PxReal far_plane)
+		{
+			//the same matrices as gluLookAt and gluPerspective
+			PxVec3 forward = dir.getNormalized();
+			PxVec3 right = forward.cross(PxVec3(0.f, 1.f, 0.f)).getNormalized();
+			PxVec3 up = right.cross(forward);
+			PxMat44 view(PxVec4(right.x, up.x, -forward.x, 0.f), PxVec4(right.y, up.y, -forward.y, 0.f),
+				PxVec4(right.z, up.z, -forward.z, 0.f), PxVec4(-right.dot(eye), -up.dot(eye), forward.dot(eye), 1.f));
+
+			PxReal f = 1.f / tanf(fov_y * PxPi / 360.f);
+			PxMat44 projection(PxVec4(f / aspect, 0.f, 0.f, 0.f), PxVec4(0.f, f, 0.f, 0.f),
+				PxVec4(0.f, 0.f, (far_plane + near_plane) / (near_plane - far_plane), -1.f),
+				PxVec4(0.f, 0.f, 2.f * far_plane * near_plane / (near_plane - far_plane), 0.f));
+
+			camera.view_projection = projection * view;
+
+			//the fixed-function light is set in eye coordinates (Renderer::Init), it follows the camera
+			PxVec3 light = PxVec3(50.f, 50.f, 100.f).getNormalized();
+			camera.light_direction = PxVec4(right * light.x + up * light.y - forward * light.z, 0.f);
+			//global ambient plus the light ambient
+			camera.ambient = PxVec4(.4f, .4f, .4f, 1.f);
+			camera.diffuse = PxVec4(.7f, .7f, .7f, 1.f);
+		}
+
+		void Add(const RenderMesh& mesh, const PxMat44& transform, const PxVec3& color, bool lit, bool shadow)
+		{
+			DrawItem item;
+			item.mesh = &mesh;
+			item.object.transform = transform;
+			item.object.color = PxVec4(color, lit ? 1.f : 0.f);
+			item.shadow = lit && shadow;
+			items.push_back(item);
+		}
+
+		//draw consecutive items of the same mesh (and shadow flag) with one call
+		static void DrawPass(bool shadow)
+		{
+			GLExt::Uniform1i(shadow_uniform, shadow ? 1 : 0);
+			for (PxU32 begin = 0, end; begin < items.size(); begin = end)
+			{
+				const RenderMesh& mesh = *items[begin].mesh;
+				bool casts_shadow = items[begin].shadow;
+				for (end = begin + 1; (end < items.size()) && (items[end].mesh == &mesh) && (items[end].shadow == casts_shadow); end++);
+
+				//unlit meshes (the ground) and the smooth cylinders are sorted with the rest but cast no shadow
+				if ((shadow && !casts_shadow) || !mesh.index_count || !mesh.vertex_buffer)
+					continue;
+
+				if (!mesh.vertex_array)
+				{
+					GLExt::GenVertexArrays(1, &mesh.vertex_array);
+					GLExt::BindVertexArray(mesh.vertex_array);
+					GLExt::BindBuffer(GL_ARRAY_BUFFER, mesh.vertex_buffer);
+					GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, mesh.index_buffer);
+					GLExt::EnableVertexAttribArray(0);
+					GLExt::VertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(RenderMesh::Vertex), 0);
+					GLExt::EnableVertexAttribArray(1);
+					GLExt::VertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(RenderMesh::Vertex), (const char*)0 + sizeof(PxVec3));
+					GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+				}
+				else
+					GLExt::BindVertexArray(mesh.vertex_array);
+
+				GLExt::Uniform1i(first_object_uniform, begin);
+				GLExt::DrawElementsInstanced(GL_TRIANGLES, mesh.index_count, GL_UNSIGNED_INT, 0, end - begin);
+				draw_calls++;
+			}
+		}
+
+		void Flush(bool shadows, const PxReal* shadow_matrix, const PxVec3& shadow_color)
+		{
+			draw_calls = 0;
+			if (items.empty())
+				return;
+
+			//group the items by mesh
+			std::stable_sort(items.begin(), items.end());
+
+			objects.resize(items.size());
+			for (PxU32 i = 0; i < items.size(); i++)
+				objects[i] = items[i].object;
+
+			camera.shadow_projection = camera.view_projection * PxMat44(const_cast<PxReal*>(shadow_matrix));
+			camera.shadow_color = PxVec4(shadow_color, 1.f);
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, camera_buffer);
+			GLExt::BufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &camera, GL_STREAM_DRAW);
+			GLExt::BindBuffer(GL_UNIFORM_BUFFER, 0);
+			GLExt::BindBufferBase(GL_UNIFORM_BUFFER, 0, camera_buffer);
+
+			//orphan the buffer of the last frame
+			GLExt::BindBuffer(GL_TEXTURE_BUFFER, object_buffer);
+			GLExt::BufferData(GL_TEXTURE_BUFFER, objects.size() * sizeof(ObjectData), &objects.front(), GL_STREAM_DRAW);
+			GLExt::BindBuffer(GL_TEXTURE_BUFFER, 0);
+			GLExt::ActiveTexture(GL_TEXTURE0 + 1);
+			glBindTexture(GL_TEXTURE_BUFFER, object_texture);
+			GLExt::TexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, object_buffer);
+
+			GLExt::UseProgram(program);
+			DrawPass(false);
+			if (shadows)
+				DrawPass(true);
+			GLExt::UseProgram(0);
+
+			GLExt::BindVertexArray(0);
+			glBindTexture(GL_TEXTURE_BUFFER, 0);
+			GLExt::ActiveTexture(GL_TEXTURE0);
+			items.clear();
+		}
+
+		PxU32 DrawCalls()
+		{
+			return draw_calls;
+		}
+	}
+}
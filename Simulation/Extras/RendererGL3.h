@@ -0,0 +1,34 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "MeshCache.h"
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Shape renderer built on core-profile OpenGL 3.3: meshes in vertex array objects, the camera and the lighting
+	///in a uniform buffer and the transforms and colours of all objects of a frame in one texture buffer.
+	///Every mesh is drawn with a single instanced call per pass, there are no per-object state changes.
+	///
+	///Only OpenGL 3.3 core functions are used so any 3.3 driver should run it (software ones such as Mesa llvmpipe are untested),
+	///the context stays a compatibility one because the text, debug data and cloth are drawn by the fixed-function path.
+	namespace RendererGL3
+	{
+		///Compile the program and create the buffers, returns false if OpenGL 3.3 is not available
+		bool Init();
+
+		///Set the camera of the frame (called by Renderer::Start)
+		void Camera(const PxVec3& eye, const PxVec3& dir, PxReal fov_y, PxReal aspect, PxReal near_plane, PxReal far_plane);
+
+		///Queue a mesh with a transform (which may include a scale), unlit meshes are not shaded and cast no shadow,
+		///shadow - a lit mesh casts a planar shadow
+		void Add(const RenderMesh& mesh, const PxMat44& transform, const PxVec3& color, bool lit=true, bool shadow=true);
+
+		///Draw the queued meshes, then their planar shadows (projected by shadow_matrix)
+		void Flush(bool shadows, const PxReal* shadow_matrix, const PxVec3& shadow_color);
+
+		///Number of draw calls issued by the last Flush
+		PxU32 DrawCalls();
+	}
+}
@@ -0,0 +1,319 @@
+#include "StaticBatch.h"
+#include "UserData.h"
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+#include <mutex>
+
+namespace VisualDebugger
+{
+	namespace StaticBatch
+	{
+		using namespace std;
+
+		struct Vertex
+		{
+			PxVec3 position;
+			PxVec3 normal;
+			PxVec3 color;
+		};
+
+		//an actor of the batch as it was baked
+		struct Entry
+		{
+			PxTransform pose;
+			vector<PxVec3> colors;
+		};
+
+		//an actor added in the current frame
+		struct Candidate
+		{
+			PxRigidActor* actor;
+			PxTransform pose;
+		};
+
+		//actors reported asleep by the simulation
+		static unordered_set<const PxActor*> asleep;
+		//actors of the batch and the candidates of the current frame
+		static unordered_map<const PxActor*, Entry> baked;
+		static vector<Candidate> candidates;
+		//a candidate is new, moved or changed colour, or a baked actor has been released
+		static bool dirty = false;
+		static Settings baked_settings = { 0, PxVec3(0.f) };
+
+		//world-space shapes: the lit triangles first, then the unlit ones (the ground)
+		static vector<Vertex> vertices;
+		static vector<GLuint> indices;
+		static vector<GLuint> unlit_indices;
+		static GLsizei lit_count = 0;
+		static GLsizei unlit_count = 0;
+		static GLuint vertex_buffer = 0;
+		static GLuint index_buffer = 0;
+		static PxU32 shape_count = 0;
+		static PxU32 rebuilds = 0;
+
+		//actors released since the last flush, the listener can be called from any thread
+		static vector<const PxBase*> released;
+		static mutex released_mutex;
+
+		class ReleaseListener : public PxDeletionListener
+		{
+		public:
+			virtual void onRelease(const PxBase* observed, void* userData, PxDeletionEventFlag::Enum deletionEvent)
+			{
+				lock_guard<mutex> lock(released_mutex);
+				released.push_back(observed);
+			}
+		};
+
+		static ReleaseListener listener;
+		static bool listening = false;
+
+		void Init()
+		{
+			if (listening)
+				return;
+
+			//an address of a released actor can be reused by a new one, which must not inherit its state
+			PxGetPhysics().registerDeletionListener(listener, PxDeletionEventFlag::eUSER_RELEASE | PxDeletionEventFlag::eMEMORY_RELEASE);
+			listening = true;
+
+			if (GLExt::BufferObjects())
+			{
+				GLExt::GenBuffers(1, &vertex_buffer);
+				GLExt::GenBuffers(1, &index_buffer);
+			}
+		}
+
+		void Flush()
+		{
+			lock_guard<mutex> lock(released_mutex);
+			for (const PxBase* object : released)
+			{
+				const PxActor* actor = static_cast<const PxActor*>(object);
+				asleep.erase(actor);
+				if (baked.erase(actor))
+					dirty = true;
+			}
+			released.clear();
+		}
+
+		void Wake(PxActor* const* actors, PxU32 count)
+		{
+			for (PxU32 i = 0; i < count; i++)
+				asleep.erase(actors[i]);
+		}
+
+		void Sleep(PxActor* const* actors, PxU32 count)
+		{
+			for (PxU32 i = 0; i < count; i++)
+				asleep.insert(actors[i]);
+		}
+
+		bool Asleep(const PxActor* actor)
+		{
+			return asleep.count(actor) != 0;
+		}
+
+		void Add(PxRigidActor* actor, const PxTransform& pose, PxShape* const* shapes, PxU32 count)
+		{
+			Candidate candidate = { actor, pose };
+			candidates.push_back(candidate);
+			if (dirty)
+				return;
+
+			unordered_map<const PxActor*, Entry>::const_iterator it = baked.find(actor);
+			if ((it == baked.end()) || !(it->second.pose.p == pose.p) || !(it->second.pose.q == pose.q) || (it->second.colors.size() != count))
+			{
+				dirty = true;
+				return;
+			}
+
+			//e.g. the highlight of the selected actor
+			for (PxU32 i = 0; i < count; i++)
+			{
+				if (shapes[i]->userData && !(*((UserData*)shapes[i]->userData)->color == it->second.colors[i]))
+				{
+					dirty = true;
+					return;
+				}
+			}
+		}
+
+		//append a render mesh transformed to the world (the transform may include a scale)
+		static void Append(const RenderMesh& mesh, const PxMat44& transform, const PxVec3& color, vector<GLuint>& target)
+		{
+			GLuint base = (GLuint)vertices.size();
+			PxMat33 normal_matrix = PxMat33(transform.column0.getXYZ(), transform.column1.getXYZ(), transform.column2.getXYZ()).getInverse().getTranspose();
+			for (PxU32 i = 0; i < mesh.vertices.size(); i++)
+			{
+				Vertex vertex = { transform.transform(mesh.vertices[i].position), (normal_matrix * mesh.vertices[i].normal).getNormalized(), color };
+				vertices.push_back(vertex);
+			}
+			for (PxU32 i = 0; i < mesh.indices.size(); i++)
+				target.push_back(base + mesh.indices[i]);
+		}
+
+		//the same unit meshes and transforms as the OpenGL 3.3 renderer
+		static void AppendShape(const PxShape* shape, PxTransform pose, const PxVec3& color, PxU32 detail)
+		{
+			PxGeometryHolder geometry = shape->getGeometry();
+			switch (geometry.getType())
+			{
+			case PxGeometryType::ePLANE:
+				//moved slightly down to avoid visual artefacts
+				pose.q *= PxQuat(PxHalfPi, PxVec3(0.f, 0.f, 1.f));
+				pose.p += PxVec3(0.f, -0.01f, 0.f);
+				Append(MeshCache::Plane(), PxMat44(pose) * PxMat44(PxVec4(10240.f, 1.f, 10240.f, 1.f)), color, unlit_indices);
+				break;
+			case PxGeometryType::eSPHERE:
+			{
+				PxReal radius = geometry.sphere().radius;
+				Append(MeshCache::Sphere(detail, detail), PxMat44(pose) * PxMat44(PxVec4(radius, radius, radius, 1.f)), color, indices);
+				break;
+			}
+			case PxGeometryType::eBOX:
+				Append(MeshCache::Box(), PxMat44(pose) * PxMat44(PxVec4(geometry.box().halfExtents, 1.f)), color, indices);
+				break;
+			case PxGeometryType::eCAPSULE:
+			{
+				PxReal radius = geometry.capsule().radius, half_height = geometry.capsule().halfHeight;
+				PxMat44 sphere_scale(PxVec4(radius, radius, radius, 1.f));
+				Append(MeshCache::Sphere(detail, detail), PxMat44(pose * PxTransform(PxVec3(half_height, 0.f, 0.f))) * sphere_scale, color, indices);
+				Append(MeshCache::Sphere(detail, detail), PxMat44(pose * PxTransform(PxVec3(-half_height, 0.f, 0.f))) * sphere_scale, color, indices);
+				Append(MeshCache::Cylinder(detail), PxMat44(pose * PxTransform(PxQuat(-PxHalfPi, PxVec3(0.f, 0.f, 1.f)))) *
+					PxMat44(PxVec4(radius, half_height, radius, 1.f)), color, indices);
+				break;
+			}
+			case PxGeometryType::eCONVEXMESH:
+				Append(MeshCache::Get(geometry.convexMesh().convexMesh), PxMat44(pose), color, indices);
+				break;
+			case PxGeometryType::eTRIANGLEMESH:
+				Append(MeshCache::Get(geometry.triangleMesh().triangleMesh), PxMat44(pose), color, indices);
+				break;
+			default:
+				break;
+			}
+		}
+
+		static void Rebuild(const Settings& settings)
+		{
+			baked.clear();
+			vertices.clear();
+			indices.clear();
+			unlit_indices.clear();
+			shape_count = 0;
+
+			vector<PxShape*> shapes;
+			for (PxU32 i = 0; i < candidates.size(); i++)
+			{
+				PxRigidActor* actor = candidates[i].actor;
+				Entry& entry = baked[actor];
+				entry.pose = candidates[i].pose;
+
+				shapes.resize(actor->getNbShapes());
+				if (shapes.empty())
+					continue;
+				actor->getShapes(&shapes.front(), (PxU32)shapes.size());
+				for (PxU32 j = 0; j < shapes.size(); j++)
+				{
+					PxVec3 color = shapes[j]->userData ? *((UserData*)shapes[j]->userData)->color : settings.default_color;
+					entry.colors.push_back(color);
+					AppendShape(shapes[j], entry.pose * shapes[j]->getLocalPose(), color, settings.detail);
+				}
+				shape_count += (PxU32)shapes.size();
+			}
+
+			lit_count = (GLsizei)indices.size();
+			unlit_count = (GLsizei)unlit_indices.size();
+			indices.insert(indices.end(), unlit_indices.begin(), unlit_indices.end());
+
+			if (vertex_buffer && !vertices.empty())
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+				GLExt::BufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(Vertex), &vertices.front(), GL_STATIC_DRAW);
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+				GLExt::BufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), &indices.front(), GL_STATIC_DRAW);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+
+			baked_settings = settings;
+			dirty = false;
+			rebuilds++;
+		}
+
+		void Draw(const Settings& settings, bool shadows, const PxReal* shadow_matrix, const PxVec3& shadow_color)
+		{
+			//every baked actor has been added again unchanged, none is missing
+			if (dirty || (candidates.size() != baked.size()) || (settings.detail != baked_settings.detail) ||
+				!(settings.default_color == baked_settings.default_color))
+				Rebuild(settings);
+			candidates.clear();
+
+			if (vertices.empty())
+				return;
+
+			const char* base = 0;
+			const GLuint* index_base = 0;
+			if (vertex_buffer)
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, vertex_buffer);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, index_buffer);
+			}
+			else
+			{
+				base = (const char*)&vertices.front();
+				index_base = &indices.front();
+			}
+
+			glEnableClientState(GL_VERTEX_ARRAY);
+			glEnableClientState(GL_NORMAL_ARRAY);
+			glEnableClientState(GL_COLOR_ARRAY);
+			glVertexPointer(3, GL_FLOAT, sizeof(Vertex), base);
+			glNormalPointer(GL_FLOAT, sizeof(Vertex), base + sizeof(PxVec3));
+			glColorPointer(3, GL_FLOAT, sizeof(Vertex), base + 2 * sizeof(PxVec3));
+
+			if (unlit_count)
+			{
+				glDisable(GL_LIGHTING);
+				glDrawElements(GL_TRIANGLES, unlit_count, GL_UNSIGNED_INT, index_base + lit_count);
+				glEnable(GL_LIGHTING);
+			}
+			if (lit_count)
+				glDrawElements(GL_TRIANGLES, lit_count, GL_UNSIGNED_INT, index_base);
+
+			glDisableClientState(GL_COLOR_ARRAY);
+			glDisableClientState(GL_NORMAL_ARRAY);
+
+			//the shadows of the lit shapes, in one colour
+			if (shadows && lit_count)
+			{
+				glDisable(GL_LIGHTING);
+				glColor4f(shadow_color.x, shadow_color.y, shadow_color.z, 1.f);
+				glPushMatrix();
+				glMultMatrixf(shadow_matrix);
+				glDrawElements(GL_TRIANGLES, lit_count, GL_UNSIGNED_INT, index_base);
+				glPopMatrix();
+				glEnable(GL_LIGHTING);
+			}
+
+			glDisableClientState(GL_VERTEX_ARRAY);
+			if (vertex_buffer)
+			{
+				GLExt::BindBuffer(GL_ARRAY_BUFFER, 0);
+				GLExt::BindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+			}
+		}
+
+		PxU32 Shapes()
+		{
+			return shape_count;
+		}
+
+		PxU32 Rebuilds()
+		{
+			return rebuilds;
+		}
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include "PxPhysicsAPI.h"
+#include "MeshCache.h"
+
+namespace VisualDebugger
+{
+	using namespace physx;
+
+	///Static and sleeping actors baked into one world-space vertex buffer: the lit shapes, the unlit ground
+	///and the planar shadows (the lit shapes drawn again under the shadow matrix) take three draws in total.
+	///The batch is rebuilt only when one of its actors wakes up, moves, changes colour or is removed.
+	namespace StaticBatch
+	{
+		///Shape settings used to bake the batch
+		struct Settings
+		{
+			PxU32 detail;
+			PxVec3 default_color;
+		};
+
+		///Start listening for released actors (called by Renderer::Init)
+		void Init();
+
+		///Drop the actors released since the last call (called at the start of Renderer::Render)
+		void Flush();
+
+		///Actors woken up by the simulation (from PxSimulationEventCallback::onWake)
+		void Wake(PxActor* const* actors, PxU32 count);
+
+		///Actors put to sleep by the simulation (from PxSimulationEventCallback::onSleep)
+		void Sleep(PxActor* const* actors, PxU32 count);
+
+		///The actor is asleep according to the notifications
+		bool Asleep(const PxActor* actor);
+
+		///Add a static or sleeping actor to the batch of the current frame, shapes are read only on a rebuild
+		void Add(PxRigidActor* actor, const PxTransform& pose, PxShape* const* shapes, PxU32 count);
+
+		///Rebuild the batch if the actors added since the last call differ from the baked ones,
+		///then draw it (with the shadows projected by shadow_matrix)
+		void Draw(const Settings& settings, bool shadows, const PxReal* shadow_matrix, const PxVec3& shadow_color);
+
+		///Number of shapes in the batch
+		PxU32 Shapes();
+
+		///Number of rebuilds since the start
+		PxU32 Rebuilds();
+	}
+}
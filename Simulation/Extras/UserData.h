@@ -8,7 +8,9 @@ class UserData
 public:
 	physx::PxVec3* color;
 	physx::PxClothMeshDesc* cloth_mesh_desc;
+	//small sphere drawn as a point sprite batched with all other particles (e.g. sawdust)
+	bool particle;
 
 	UserData(physx::PxVec3* _color=0, physx::PxClothMeshDesc* _cloth_mesh_desc=0) :
-		color(_color), cloth_mesh_desc(_cloth_mesh_desc) {}
+		color(_color), cloth_mesh_desc(_cloth_mesh_desc), particle(false) {}
 };
\ No newline at end of file
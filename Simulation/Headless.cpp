@@ -0,0 +1,337 @@
+#include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "MyPhysicsEngine.h"
+#include "Benchmark.h"
+
+///Headless batch runner.
+
+///
+///Steps PhysicsEngine::MyScene as fast as possible without a window (no GL/GLUT),
+///drives the player (and so the chainsaw) from a scripted input timeline
+///and prints per-step timings and final statistics.
+///
+
+using namespace std;
+using namespace physx;
+
+///A single scripted input: run the command at the given simulation time
+struct TimelineEvent
+{
+	PxReal time;
+	string command;
+};
+
+void Usage()
+{
+	cerr << "Usage: Headless [options]" << endl;
+	cerr << "    --steps N       - number of simulation steps (default 900)" << endl;
+	cerr << "    --seconds S     - simulated time, overrides --steps" << endl;
+	cerr << "    --dt DT         - step size in seconds (default 1/90)" << endl;
+	cerr << "    --threads N     - number of PhysX worker threads (0 - auto)" << endl;
+	cerr << "    --affinity MASK - pin worker threads to the cores in MASK (e.g. 0xF)" << endl;
+	cerr << "    --script FILE   - input timeline, one \"<time> <command> [repeat]\" per line" << endl;
+	cerr << "                      commands: left, right, up, down, reset" << endl;
+	cerr << "    --record FILE   - save the applied input commands to a binary log" << endl;
+	cerr << "    --replay FILE   - apply the commands of a recorded log instead of the script" << endl;
+	cerr << "    --quiet         - do not print per-step timings" << endl;
+	cerr << "    --trace FILE    - write the profiling zones of the run as a Chrome trace (PROFILER builds)" << endl;
+	cerr << "    --bench threads   - print step times for 1/2/4/8/N worker threads and exit" << endl;
+	cerr << "    --bench shapes    - print actor construction times for 66 and 1000 shapes and exit" << endl;
+	cerr << "    --bench startup   - print the scene startup time with cooked and with packed meshes and exit" << endl;
+	cerr << "    --bench particles - print the step time of 100k cloud particles and of each backend at 500/5k/50k and exit" << endl;
+	cerr << "    --mesh-pack FILE - cooked mesh pack (default meshes.pack, \"\" - always cook)" << endl;
+	cerr << "    --particles rigid|cloud|physx - sawdust backend (default cloud)" << endl;
+}
+
+///Walk the player into the tree trigger, which starts the chainsaw
+void DefaultTimeline(vector<TimelineEvent>& timeline)
+{
+	for (int i = 0; i < 24; i++)
+	{
+		TimelineEvent event = { 0.5f + i * 0.1f, "left" };
+		timeline.push_back(event);
+	}
+}
+
+bool LoadTimeline(const char* filename, vector<TimelineEvent>& timeline)
+{
+	ifstream file(filename);
+	if (!file)
+		return false;
+
+	string line;
+	while (getline(file, line))
+	{
+		//skip empty lines and comments
+		if (line.empty() || line[0] == '#')
+			continue;
+
+		istringstream input(line);
+		TimelineEvent event;
+		int repeat = 1;
+		if (!(input >> event.time >> event.command))
+			continue;
+		input >> repeat;
+
+		for (int i = 0; i < repeat; i++)
+			timeline.push_back(event);
+	}
+
+	stable_sort(timeline.begin(), timeline.end(),
+		[](const TimelineEvent& a, const TimelineEvent& b) { return a.time < b.time; });
+	return true;
+}
+
+bool Execute(PhysicsEngine::MyScene* scene, const string& command)
+{
+	if (command == "left")
+		scene->Execute(PhysicsEngine::MOVE_LEFT);
+	else if (command == "right")
+		scene->Execute(PhysicsEngine::MOVE_RIGHT);
+	else if (command == "up")
+		scene->Execute(PhysicsEngine::MOVE_UP);
+	else if (command == "down")
+		scene->Execute(PhysicsEngine::MOVE_DOWN);
+	else if (command == "reset")
+		scene->Reset();
+	else
+		return false;
+	return true;
+}
+
+int Run(PhysicsEngine::MyScene* scene, PxU32 steps, PxReal dt, const vector<TimelineEvent>& timeline, bool quiet)
+{
+	vector<double> times;
+	times.reserve(steps);
+	size_t next_event = 0;
+
+	//fixed-point timings, the caller's format is restored on return
+	ios::fmtflags flags = cout.flags();
+	streamsize precision = cout.precision();
+	cout << fixed;
+	if (!quiet)
+		cout << "step,time,ms" << endl;
+
+	chrono::high_resolution_clock::time_point run_start = chrono::high_resolution_clock::now();
+	for (PxU32 i = 0; i < steps; i++)
+	{
+		PxReal sim_time = i * dt;
+
+		//apply all inputs due before this step
+		for (; (next_event < timeline.size()) && (timeline[next_event].time <= sim_time); next_event++)
+		{
+			if (!Execute(scene, timeline[next_event].command))
+				cerr << "Unknown command: " << timeline[next_event].command << endl;
+		}
+
+		chrono::high_resolution_clock::time_point start = chrono::high_resolution_clock::now();
+		scene->Update(dt);
+		double ms = chrono::duration<double, milli>(chrono::high_resolution_clock::now() - start).count();
+		times.push_back(ms);
+
+		if (!quiet)
+			cout << i << "," << setprecision(4) << sim_time + dt << "," << setprecision(3) << ms << "\n";
+	}
+	double wall = chrono::duration<double>(chrono::high_resolution_clock::now() - run_start).count();
+
+	//final stats
+	vector<double> sorted(times);
+	sort(sorted.begin(), sorted.end());
+	double total = 0.;
+	for (double t : times)
+		total += t;
+
+	vector<PxActor*> actors = scene->GetAllActors();
+	PxU32 dynamic_actors = 0;
+	for (PxActor* actor : actors)
+		if (actor->getType() == PxActorType::eRIGID_DYNAMIC)
+			dynamic_actors++;
+
+	cout << endl;
+	cout << "steps:          " << steps << " x " << setprecision(4) << dt << "s (" << setprecision(2) << steps * dt << "s simulated)" << endl;
+	cout << "wall time:      " << setprecision(3) << wall << "s (" << setprecision(1) << (wall > 0. ? (steps * dt) / wall : 0.) << "x real time)" << endl;
+	if (steps)
+	{
+		cout << setprecision(3) << "step time (ms): mean " << total / steps << ", min " << sorted.front() << ", max " << sorted.back()
+			<< ", p95 " << sorted[min((size_t)(steps * 0.95), sorted.size() - 1)] << endl;
+	}
+	cout << "actors:         " << actors.size() << " (" << dynamic_actors << " dynamic)" << endl;
+	cout << "inputs applied: " << next_event << "/" << timeline.size() << endl;
+	cout << "house broken:   " << (scene->HouseBroken() ? "yes" : "no") << endl;
+
+	PhysicsEngine::ParticlePoolStats pool;
+	if (scene->SawdustStats(pool))
+		cout << "sawdust pool:   " << pool.active << " active, " << pool.allocated << "/" << pool.capacity << " allocated, "
+			<< pool.recycled << " recycled, " << pool.dropped << " dropped" << endl;
+
+	cout.flags(flags);
+	cout.precision(precision);
+	return 0;
+}
+
+int main(int argc, char** argv)
+{
+	PhysicsEngine::SceneConfig config;
+	PxU32 steps = 900;
+	PxReal seconds = 0.f;
+	PxReal dt = 1.f / 90.f;
+	const char* script = 0;
+	const char* bench = 0;
+	PhysicsEngine::ParticleBackend backend = PhysicsEngine::CLOUD_PARTICLES;
+	const char* record = 0;
+	const char* replay = 0;
+	const char* trace = 0;
+	bool quiet = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--steps") && (i + 1 < argc))
+			steps = (PxU32)strtoul(argv[++i], 0, 0);
+		else if (!strcmp(argv[i], "--seconds") && (i + 1 < argc))
+			seconds = (PxReal)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--dt") && (i + 1 < argc))
+			dt = (PxReal)atof(argv[++i]);
+		else if (!strcmp(argv[i], "--threads") && (i + 1 < argc))
+			config.threads = (PxU32)strtoul(argv[++i], 0, 0);
+		else if (!strcmp(argv[i], "--affinity") && (i + 1 < argc))
+			config.affinity_mask = (PxU32)strtoul(argv[++i], 0, 0);
+		else if (!strcmp(argv[i], "--script") && (i + 1 < argc))
+			script = argv[++i];
+		else if (!strcmp(argv[i], "--record") && (i + 1 < argc))
+			record = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && (i + 1 < argc))
+			replay = argv[++i];
+		else if (!strcmp(argv[i], "--trace") && (i + 1 < argc))
+			trace = argv[++i];
+		else if (!strcmp(argv[i], "--mesh-pack") && (i + 1 < argc))
+			PhysicsEngine::MeshPackFile(argv[++i]);
+		else if (!strcmp(argv[i], "--bench") && (i + 1 < argc))
+			bench = argv[++i];
+		else if (!strcmp(argv[i], "--particles") && (i + 1 < argc) && PhysicsEngine::ParticleBackendByName(argv[i + 1], backend))
+			i++;
+		else if (!strcmp(argv[i], "--quiet"))
+			quiet = true;
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if ((dt <= 0.f) || (bench && strcmp(bench, "threads") && strcmp(bench, "shapes") && strcmp(bench, "startup") && strcmp(bench, "particles")) || (record && replay))
+	{
+		Usage();
+		return 1;
+	}
+
+	if (seconds > 0.f)
+		steps = (PxU32)(seconds / dt + .5f);
+
+	if (trace && !Profiler::Available())
+	{
+		cerr << "Profiling zones are not compiled in (define PROFILER), no trace is written" << endl;
+		trace = 0;
+	}
+
+	PhysicsEngine::InputRecorder input;
+	vector<TimelineEvent> timeline;
+	if (replay)
+	{
+		if (!input.Load(replay))
+		{
+			cerr << "Could not read the input log: " << replay << endl;
+			return 1;
+		}
+	}
+	else if (script)
+	{
+		if (!LoadTimeline(script, timeline))
+		{
+			cerr << "Could not read the script: " << script << endl;
+			return 1;
+		}
+	}
+	else
+		DefaultTimeline(timeline);
+
+	int result = 0;
+	try
+	{
+		PhysicsEngine::PxInit();
+
+		if (bench && !strcmp(bench, "shapes"))
+			Benchmark::Shapes();
+		else if (bench && !strcmp(bench, "startup"))
+			Benchmark::Startup(config);
+		else if (bench && !strcmp(bench, "particles"))
+		{
+			Benchmark::Particles(100000, steps, dt);
+			Benchmark::ParticleBackends(config, steps, dt);
+		}
+		else if (bench)
+			Benchmark::Threads(steps, dt);
+		else
+		{
+			//the reset commands restore the scene in place, the benchmarks above do not snapshot
+			config.snapshot = true;
+			PhysicsEngine::MyScene* scene = new PhysicsEngine::MyScene(config);
+			scene->Init();
+			scene->SawdustBackend(backend);
+			cout << "worker threads: " << PhysicsEngine::WorkerThreads(config) << endl;
+
+			if (replay)
+				scene->StartReplay(input);
+			else if (record)
+				scene->StartRecording();
+
+			if (trace)
+				Profiler::Start();
+
+			result = Run(scene, steps, dt, timeline, quiet);
+
+			if (trace)
+			{
+				Profiler::Stop();
+				if (!Profiler::WriteChromeTrace(trace))
+				{
+					cerr << "Could not write the trace: " << trace << endl;
+					result = 1;
+				}
+				else
+					cout << "trace:          " << trace << endl;
+			}
+
+			if (replay)
+				cout << "input log:      " << input.Events().size() << " commands replayed from " << replay << endl;
+			else if (record)
+			{
+				const PhysicsEngine::InputRecorder& recorded = scene->StopRecording();
+				if (!recorded.Save(record))
+				{
+					cerr << "Could not write the input log: " << record << endl;
+					result = 1;
+				}
+				else
+					cout << "input log:      " << recorded.Events().size() << " commands recorded to " << record << endl;
+			}
+			delete scene;
+		}
+	}
+	catch (Exception* exc)
+	{
+		cerr << exc->what() << endl;
+		delete exc;
+		return 1;
+	}
+
+	PhysicsEngine::PxRelease();
+	return result;
+}
@@ -0,0 +1,136 @@
+#include "InputRecorder.h"
+#include <fstream>
+#include <cstring>
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	static const char input_magic[4] = { 'S', 'I', 'M', 'I' };
+	//version 2: compound actors get their mass from the final shape poses, older logs would replay differently
+	static const PxU8 input_version = 2;
+
+	static void WriteU32(ofstream& file, PxU32 value)
+	{
+		for (PxU32 i = 0; i < 4; i++)
+			file.put((char)((value >> (8 * i)) & 0xFF));
+	}
+
+	static bool ReadU32(ifstream& file, PxU32& value)
+	{
+		value = 0;
+		for (PxU32 i = 0; i < 4; i++)
+		{
+			int byte = file.get();
+			if (byte == EOF)
+				return false;
+			value |= (PxU32)byte << (8 * i);
+		}
+		return true;
+	}
+
+	//7 bits per byte, the top bit marks a continuation (most deltas fit in a single byte)
+	static void WriteVarint(ofstream& file, PxU32 value)
+	{
+		while (value >= 0x80)
+		{
+			file.put((char)((value & 0x7F) | 0x80));
+			value >>= 7;
+		}
+		file.put((char)value);
+	}
+
+	static bool ReadVarint(ifstream& file, PxU32& value)
+	{
+		value = 0;
+		for (PxU32 shift = 0; shift < 35; shift += 7)
+		{
+			int byte = file.get();
+			if (byte == EOF)
+				return false;
+			value |= (PxU32)(byte & 0x7F) << shift;
+			if (!(byte & 0x80))
+				return true;
+		}
+		return false;
+	}
+
+	void InputRecorder::Clear(PxU32 new_seed)
+	{
+		events.clear();
+		seed = new_seed;
+		cursor = 0;
+	}
+
+	void InputRecorder::Record(PxU32 step, InputCommand command)
+	{
+		Event event = { step, command };
+		events.push_back(event);
+	}
+
+	bool InputRecorder::Save(const string& filename) const
+	{
+		ofstream file(filename.c_str(), ios::binary);
+		if (!file)
+			return false;
+
+		file.write(input_magic, sizeof(input_magic));
+		file.put((char)input_version);
+		WriteU32(file, seed);
+
+		PxU32 step = 0;
+		for (size_t i = 0; i < events.size(); i++)
+		{
+			WriteVarint(file, events[i].step - step);
+			file.put((char)events[i].command);
+			step = events[i].step;
+		}
+
+		return file.good();
+	}
+
+	bool InputRecorder::Load(const string& filename)
+	{
+		ifstream file(filename.c_str(), ios::binary);
+		if (!file)
+			return false;
+
+		char magic[sizeof(input_magic)];
+		if (!file.read(magic, sizeof(magic)) || memcmp(magic, input_magic, sizeof(magic)) || (file.get() != input_version))
+			return false;
+
+		PxU32 new_seed;
+		if (!ReadU32(file, new_seed))
+			return false;
+
+		vector<Event> new_events;
+		PxU32 step = 0, delta;
+		while (ReadVarint(file, delta))
+		{
+			int command = file.get();
+			if ((command == EOF) || (command >= INPUT_COMMAND_COUNT))
+				return false;
+			step += delta;
+			Event event = { step, (InputCommand)command };
+			new_events.push_back(event);
+		}
+
+		events.swap(new_events);
+		seed = new_seed;
+		cursor = 0;
+		return true;
+	}
+
+	bool InputRecorder::Next(PxU32 step, InputCommand& command)
+	{
+		//events of steps already passed cannot be applied any more
+		while ((cursor < events.size()) && (events[cursor].step < step))
+			cursor++;
+
+		if ((cursor >= events.size()) || (events[cursor].step != step))
+			return false;
+
+		command = events[cursor++].command;
+		return true;
+	}
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Commands that change the simulation (camera and display keys are not recorded)
+	enum InputCommand
+	{
+		MOVE_LEFT,
+		MOVE_RIGHT,
+		MOVE_UP,
+		MOVE_DOWN,
+		FORCE_FORWARD,
+		FORCE_BACKWARD,
+		FORCE_LEFT,
+		FORCE_RIGHT,
+		FORCE_UP,
+		FORCE_DOWN,
+		SELECT_NEXT,
+		INPUT_COMMAND_COUNT
+	};
+
+	///Records input commands stamped with the simulation step they were applied at
+	///and plays them back at exactly the same steps.
+	///
+	///File format (little endian): "SIMI" magic, a version byte, the random seed (4 bytes),
+	///then one record per command: the step delta to the previous command as a varint and the command byte.
+	class InputRecorder
+	{
+	public:
+		struct Event
+		{
+			PxU32 step;
+			InputCommand command;
+		};
+
+	private:
+		std::vector<Event> events;
+		//seed of the random generator (e.g. the sawdust particles) for the recorded run
+		PxU32 seed;
+		//replay position
+		size_t cursor;
+
+	public:
+		InputRecorder(PxU32 _seed=0) : seed(_seed), cursor(0) {}
+
+		///Drop all events and start over with the given seed
+		void Clear(PxU32 new_seed);
+
+		///Append a command applied before the step following the given number of completed steps
+		void Record(PxU32 step, InputCommand command);
+
+		///Write the log to a binary file
+		bool Save(const std::string& filename) const;
+
+		///Read the log from a binary file, the replay starts from the first event
+		bool Load(const std::string& filename);
+
+		///Start the replay from the first event
+		void Rewind() { cursor = 0; }
+
+		///Get the next command due at the given step, returns false when there are no more for this step
+		bool Next(PxU32 step, InputCommand& command);
+
+		///All events have been replayed
+		bool Finished() const { return cursor >= events.size(); }
+
+		const std::vector<Event>& Events() const { return events; }
+
+		PxU32 Seed() const { return seed; }
+	};
+}
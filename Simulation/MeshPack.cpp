@@ -0,0 +1,451 @@
+#include "MeshPack.h"
+#include "PhysicsEngine.h"
+#include <vector>
+#include <map>
+#include <mutex>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace PhysicsEngine
+{
+	using namespace std;
+
+	enum MeshType
+	{
+		CONVEX_MESH = 1,
+		TRIANGLE_MESH = 2
+	};
+
+	struct PackHeader
+	{
+		char magic[4];
+		PxU32 format;
+		PxU32 physics_version;
+		PxU32 entries;
+		PxU64 params_hash;
+	};
+
+	struct PackEntry
+	{
+		PxU64 hash;
+		PxU32 type;
+		PxU32 size;
+		PxU64 offset;
+		//checked on lookup, so that meshes with colliding hashes are not mixed up
+		PxU64 checksum;
+		PxU32 vertices;
+	};
+
+	//cooked bytes of a mesh and what identifies it apart from the hash
+	struct CookedMesh
+	{
+		PxU32 type;
+		PxU32 vertices;
+		PxU64 checksum;
+		vector<PxU8> data;
+	};
+
+	static const char pack_magic[4] = { 'S', 'I', 'M', 'P' };
+	static const PxU32 pack_format = 2;
+	static const PxU64 pack_alignment = 16;
+
+	//FNV-1a
+	static const PxU64 hash_seed = 14695981039346656037ull;
+	static const PxU64 hash_prime = 1099511628211ull;
+	//the checksum is the same hash started from another basis
+	static const PxU64 checksum_seed = 8317987319222330741ull;
+
+	string pack_file = "meshes.pack";
+	mutex pack_mutex;
+	MeshPackStats pack_stats = { 0, 0, 0 };
+
+	//mapped pack
+	const PxU8* pack_data = 0;
+	size_t pack_size = 0;
+	const PackEntry* pack_entries = 0;
+#ifdef _WIN32
+	HANDLE pack_handle = INVALID_HANDLE_VALUE;
+	HANDLE pack_mapping = 0;
+#endif
+
+	//meshes cooked since the pack was opened (by hash)
+	map<PxU64, CookedMesh> cooked_meshes;
+
+	static void Hash(PxU64& hash, const void* data, size_t size)
+	{
+		const PxU8* bytes = (const PxU8*)data;
+		for (size_t i = 0; i < size; i++)
+			hash = (hash ^ bytes[i]) * hash_prime;
+	}
+
+	template<class T>
+	static void Hash(PxU64& hash, const T& value)
+	{
+		Hash(hash, &value, sizeof(T));
+	}
+
+	static void Hash(PxU64& hash, const PxBoundedData& data)
+	{
+		Hash(hash, data.count);
+		Hash(hash, data.stride);
+		if (data.data)
+			Hash(hash, data.data, (size_t)data.count * data.stride);
+	}
+
+	//everything that changes the cooked output apart from the mesh itself
+	static PxU64 ParamsHash()
+	{
+		const PxCookingParams& params = GetCooking()->getParams();
+
+		PxU64 hash = hash_seed;
+		Hash(hash, params.scale.length);
+		Hash(hash, params.scale.speed);
+		Hash(hash, params.areaTestEpsilon);
+		Hash(hash, params.meshWeldTolerance);
+		Hash(hash, (PxU32)params.meshPreprocessParams);
+		Hash(hash, params.suppressTriangleMeshRemapTable);
+		Hash(hash, params.buildTriangleAdjacencies);
+#if PX_PHYSICS_VERSION >= 0x304000
+		Hash(hash, params.planeTolerance);
+		Hash(hash, (PxU32)params.convexMeshCookingType);
+		Hash(hash, params.buildGPUData);
+		Hash(hash, (PxU32)params.midphaseDesc.getType());
+		if (params.midphaseDesc.getType() == PxMeshMidPhase::eBVH33)
+		{
+			Hash(hash, params.midphaseDesc.mBVH33Desc.meshSizePerformanceTradeOff);
+			Hash(hash, (PxU32)params.midphaseDesc.mBVH33Desc.meshCookingHint);
+		}
+		else
+			Hash(hash, params.midphaseDesc.mBVH34Desc.numTrisPerLeaf);
+#else
+		Hash(hash, params.meshSizePerformanceTradeOff);
+		Hash(hash, (PxU32)params.meshCookingHint);
+#endif
+		return hash;
+	}
+
+	static void UnmapPack()
+	{
+#ifdef _WIN32
+		if (pack_data)
+			UnmapViewOfFile(pack_data);
+		if (pack_mapping)
+			CloseHandle(pack_mapping);
+		if (pack_handle != INVALID_HANDLE_VALUE)
+			CloseHandle(pack_handle);
+		pack_mapping = 0;
+		pack_handle = INVALID_HANDLE_VALUE;
+#else
+		if (pack_data)
+			munmap((void*)pack_data, pack_size);
+#endif
+		pack_data = 0;
+		pack_size = 0;
+		pack_entries = 0;
+		pack_stats.entries = 0;
+	}
+
+	static bool MapPack()
+	{
+#ifdef _WIN32
+		pack_handle = CreateFileA(pack_file.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+		if (pack_handle == INVALID_HANDLE_VALUE)
+			return false;
+
+		LARGE_INTEGER size;
+		if (!GetFileSizeEx(pack_handle, &size) || !size.QuadPart)
+		{
+			UnmapPack();
+			return false;
+		}
+
+		pack_mapping = CreateFileMappingA(pack_handle, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (pack_mapping)
+			pack_data = (const PxU8*)MapViewOfFile(pack_mapping, FILE_MAP_READ, 0, 0, 0);
+		pack_size = (size_t)size.QuadPart;
+#else
+		int file = open(pack_file.c_str(), O_RDONLY);
+		if (file < 0)
+			return false;
+
+		struct stat info;
+		if (!fstat(file, &info) && info.st_size)
+		{
+			void* data = mmap(0, (size_t)info.st_size, PROT_READ, MAP_PRIVATE, file, 0);
+			if (data != MAP_FAILED)
+			{
+				pack_data = (const PxU8*)data;
+				pack_size = (size_t)info.st_size;
+			}
+		}
+		close(file);
+#endif
+		if (!pack_data)
+		{
+			UnmapPack();
+			return false;
+		}
+
+		//a pack of another PhysX version or cooked with other params is stale
+		const PackHeader* header = (const PackHeader*)pack_data;
+		if ((pack_size < sizeof(PackHeader)) || memcmp(header->magic, pack_magic, sizeof(pack_magic)) ||
+			(header->format != pack_format) || (header->physics_version != PX_PHYSICS_VERSION) ||
+			(header->params_hash != ParamsHash()) ||
+			(pack_size < sizeof(PackHeader) + (size_t)header->entries * sizeof(PackEntry)))
+		{
+			UnmapPack();
+			return false;
+		}
+
+		pack_entries = (const PackEntry*)(pack_data + sizeof(PackHeader));
+		for (PxU32 i = 0; i < header->entries; i++)
+		{
+			if ((pack_entries[i].offset > pack_size) || (pack_entries[i].size > pack_size - pack_entries[i].offset))
+			{
+				UnmapPack();
+				return false;
+			}
+		}
+
+		pack_stats.entries = header->entries;
+		return true;
+	}
+
+	//find the cooked bytes in the pack or among the meshes cooked in this run
+	static bool Find(PxU64 hash, PxU32 type, PxU32 vertices, PxU64 checksum, const PxU8*& data, PxU32& size)
+	{
+		if (pack_entries)
+		{
+			const PackEntry* end = pack_entries + pack_stats.entries;
+			const PackEntry* entry = lower_bound(pack_entries, end, hash,
+				[](const PackEntry& e, PxU64 h) { return e.hash < h; });
+			if ((entry != end) && (entry->hash == hash) && (entry->type == type) &&
+				(entry->vertices == vertices) && (entry->checksum == checksum))
+			{
+				data = pack_data + entry->offset;
+				size = entry->size;
+				return true;
+			}
+		}
+
+		map<PxU64, CookedMesh>::const_iterator it = cooked_meshes.find(hash);
+		if ((it != cooked_meshes.end()) && (it->second.type == type) &&
+			(it->second.vertices == vertices) && (it->second.checksum == checksum))
+		{
+			data = it->second.data.data();
+			size = (PxU32)it->second.data.size();
+			return true;
+		}
+
+		return false;
+	}
+
+	//keep the cooked bytes for the next SaveMeshPack
+	static void StoreCooked(PxU64 hash, PxU32 type, PxU32 vertices, PxU64 checksum, PxDefaultMemoryOutputStream& stream)
+	{
+		CookedMesh& mesh = cooked_meshes[hash];
+		mesh.type = type;
+		mesh.vertices = vertices;
+		mesh.checksum = checksum;
+		mesh.data.assign(stream.getData(), stream.getData() + stream.getSize());
+	}
+
+	void MeshPackFile(const string& filename)
+	{
+		lock_guard<mutex> lock(pack_mutex);
+		pack_file = filename;
+	}
+
+	bool OpenMeshPack()
+	{
+		lock_guard<mutex> lock(pack_mutex);
+
+		UnmapPack();
+		cooked_meshes.clear();
+		pack_stats.loaded = pack_stats.cooked = 0;
+
+		if (pack_file.empty())
+			return false;
+
+		return MapPack();
+	}
+
+	bool SaveMeshPack()
+	{
+		lock_guard<mutex> lock(pack_mutex);
+
+		if (pack_file.empty() || cooked_meshes.empty())
+			return true;
+
+		//all entries sorted by hash, the ones already in the pack are copied across
+		map<PxU64, CookedMesh> entries(cooked_meshes);
+		for (PxU32 i = 0; i < pack_stats.entries; i++)
+		{
+			const PackEntry& entry = pack_entries[i];
+			CookedMesh& mesh = entries[entry.hash];
+			mesh.type = entry.type;
+			mesh.vertices = entry.vertices;
+			mesh.checksum = entry.checksum;
+			mesh.data.assign(pack_data + entry.offset, pack_data + entry.offset + entry.size);
+		}
+
+		PackHeader header;
+		memcpy(header.magic, pack_magic, sizeof(pack_magic));
+		header.format = pack_format;
+		header.physics_version = PX_PHYSICS_VERSION;
+		header.entries = (PxU32)entries.size();
+		header.params_hash = ParamsHash();
+
+		vector<PackEntry> table;
+		PxU64 offset = sizeof(PackHeader) + entries.size() * sizeof(PackEntry);
+		for (map<PxU64, CookedMesh>::const_iterator it = entries.begin(); it != entries.end(); it++)
+		{
+			offset = (offset + pack_alignment - 1) & ~(pack_alignment - 1);
+			//zeroed, so that the padding bytes written are always the same
+			PackEntry entry;
+			memset(&entry, 0, sizeof(entry));
+			entry.hash = it->first;
+			entry.type = it->second.type;
+			entry.size = (PxU32)it->second.data.size();
+			entry.offset = offset;
+			entry.checksum = it->second.checksum;
+			entry.vertices = it->second.vertices;
+			table.push_back(entry);
+			offset += entry.size;
+		}
+
+		//the file cannot be replaced while it is mapped
+		UnmapPack();
+
+		FILE* file = fopen(pack_file.c_str(), "wb");
+		if (!file)
+			return false;
+
+		bool ok = (fwrite(&header, sizeof(header), 1, file) == 1) &&
+			(fwrite(table.data(), sizeof(PackEntry), table.size(), file) == table.size());
+
+		PxU64 position = sizeof(PackHeader) + table.size() * sizeof(PackEntry);
+		const PxU8 padding[pack_alignment] = { 0 };
+		map<PxU64, CookedMesh>::const_iterator it = entries.begin();
+		for (PxU32 i = 0; ok && (i < table.size()); i++, it++)
+		{
+			ok = (fwrite(padding, 1, (size_t)(table[i].offset - position), file) == (size_t)(table[i].offset - position)) &&
+				(fwrite(it->second.data.data(), 1, it->second.data.size(), file) == it->second.data.size());
+			position = table[i].offset + table[i].size;
+		}
+		ok = !fclose(file) && ok;
+
+		if (ok)
+			cooked_meshes.clear();
+
+		MapPack();
+		return ok;
+	}
+
+	void CloseMeshPack()
+	{
+		lock_guard<mutex> lock(pack_mutex);
+
+		UnmapPack();
+		cooked_meshes.clear();
+	}
+
+	PxConvexMesh* CookConvexMesh(const PxConvexMeshDesc& desc)
+	{
+		PxU64 hash = hash_seed;
+		Hash(hash, (PxU32)CONVEX_MESH);
+		Hash(hash, desc.points);
+		Hash(hash, desc.polygons);
+		Hash(hash, desc.indices);
+		Hash(hash, (PxU16)desc.flags);
+		Hash(hash, desc.vertexLimit);
+
+		PxU64 checksum = checksum_seed;
+		Hash(checksum, desc.points);
+		Hash(checksum, desc.polygons);
+		Hash(checksum, desc.indices);
+
+		lock_guard<mutex> lock(pack_mutex);
+
+		const PxU8* data;
+		PxU32 size;
+		if (Find(hash, CONVEX_MESH, desc.points.count, checksum, data, size))
+		{
+			PxDefaultMemoryInputData input((PxU8*)data, size);
+			PxConvexMesh* mesh = GetPhysics()->createConvexMesh(input);
+			if (mesh)
+			{
+				pack_stats.loaded++;
+				return mesh;
+			}
+		}
+
+		PxDefaultMemoryOutputStream stream;
+		if (!GetCooking()->cookConvexMesh(desc, stream))
+			return 0;
+
+		pack_stats.cooked++;
+		if (!pack_file.empty())
+			StoreCooked(hash, CONVEX_MESH, desc.points.count, checksum, stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+		return GetPhysics()->createConvexMesh(input);
+	}
+
+	PxTriangleMesh* CookTriangleMesh(const PxTriangleMeshDesc& desc)
+	{
+		PxU64 hash = hash_seed;
+		Hash(hash, (PxU32)TRIANGLE_MESH);
+		Hash(hash, desc.points);
+		Hash(hash, desc.triangles);
+		Hash(hash, (PxU16)desc.flags);
+
+		PxU64 checksum = checksum_seed;
+		Hash(checksum, desc.points);
+		Hash(checksum, desc.triangles);
+
+		lock_guard<mutex> lock(pack_mutex);
+
+		const PxU8* data;
+		PxU32 size;
+		if (Find(hash, TRIANGLE_MESH, desc.points.count, checksum, data, size))
+		{
+			PxDefaultMemoryInputData input((PxU8*)data, size);
+			PxTriangleMesh* mesh = GetPhysics()->createTriangleMesh(input);
+			if (mesh)
+			{
+				pack_stats.loaded++;
+				return mesh;
+			}
+		}
+
+		PxDefaultMemoryOutputStream stream;
+		if (!GetCooking()->cookTriangleMesh(desc, stream))
+			return 0;
+
+		pack_stats.cooked++;
+		if (!pack_file.empty())
+			StoreCooked(hash, TRIANGLE_MESH, desc.points.count, checksum, stream);
+
+		PxDefaultMemoryInputData input(stream.getData(), stream.getSize());
+		return GetPhysics()->createTriangleMesh(input);
+	}
+
+	MeshPackStats GetMeshPackStats()
+	{
+		lock_guard<mutex> lock(pack_mutex);
+		return pack_stats;
+	}
+}
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Cooked mesh pack.
+	///
+	///All convex and triangle meshes are cooked through CookConvexMesh/CookTriangleMesh,
+	///the cooked bytes are kept in a single file indexed by a hash of the mesh description.
+	///Later runs memory-map the file and create the meshes straight from the mapped bytes.
+	///The pack is ignored (and rewritten) when the PhysX version or the cooking params change.
+	///
+	///File layout: header {"SIMP", format version, PX_PHYSICS_VERSION, cooking params hash, entry count},
+	///entry table sorted by hash {hash, type, size, offset, checksum, vertex count}, cooked data (16-byte aligned).
+	///A mesh is taken from the pack only if its vertex count and checksum match as well.
+
+	///Statistics of the meshes created since the pack was opened
+	struct MeshPackStats
+	{
+		PxU32 entries; //meshes in the mapped pack
+		PxU32 loaded; //meshes created without cooking (from the pack or cooked earlier in this run)
+		PxU32 cooked; //meshes cooked (missing from the pack)
+	};
+
+	///Set the pack file (empty - always cook), used by the next OpenMeshPack
+	void MeshPackFile(const std::string& filename);
+
+	///Map the pack file if it is valid for the current PhysX version and cooking params (called by PxInit)
+	bool OpenMeshPack();
+
+	///Write the pack again if meshes were cooked since it was opened (called by PxRelease)
+	bool SaveMeshPack();
+
+	///Unmap the pack file and drop the meshes cooked since opening
+	void CloseMeshPack();
+
+	///Create a convex mesh from the pack or cook it (returns 0 if cooking fails)
+	PxConvexMesh* CookConvexMesh(const PxConvexMeshDesc& desc);
+
+	///Create a triangle mesh from the pack or cook it (returns 0 if cooking fails)
+	PxTriangleMesh* CookTriangleMesh(const PxTriangleMeshDesc& desc);
+
+	///Get the pack statistics
+	MeshPackStats GetMeshPackStats();
+}
@@ -4,9 +4,15 @@
 #include "CustomActors.h"
 #include "ParticleSystem.h"
 #include "RC_Cylinder.h"
+#include "InputRecorder.h"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 #include <random>
+#include <cstring>
+#include <cstdlib>
+#include <ctime>
+#include <chrono>
 
 namespace PhysicsEngine
 {
@@ -61,8 +67,28 @@ namespace PhysicsEngine
 		bool trigger;
 		bool fallen;
 		bool chainsawTrigger;
+		//collect the actors woken up and put to sleep (e.g. for render batching), only the last change of an actor is kept
+		bool sleepEvents;
+		vector<PxActor*> woken;
+		vector<PxActor*> slept;
+		//list (awake - woken) and position of every actor collected, a later change moves it in constant time
+		unordered_map<PxActor*, pair<bool, size_t> > sleep_changes;
 
-		MySimulationEventCallback() : trigger(false), fallen(false), chainsawTrigger(false) {}
+		MySimulationEventCallback() : trigger(false), fallen(false), chainsawTrigger(false), sleepEvents(false) {}
+
+		///Drop the collected sleep state changes
+		void ClearSleepChanges()
+		{
+			woken.clear();
+			slept.clear();
+			sleep_changes.clear();
+		}
+
+		///Compare actor names by value (names are not pooled across compilers)
+		static bool IsNamed(const PxActor* actor, const char* name)
+		{
+			return actor->getName() && !strcmp(actor->getName(), name);
+		}
 
 		///Method called when the contact with the trigger object is detected.
 		virtual void onTrigger(PxTriggerPair* pairs, PxU32 count) 
@@ -76,7 +102,7 @@ namespace PhysicsEngine
 					//check if eNOTIFY_TOUCH_FOUND trigger
 					if (pairs[i].status & PxPairFlag::eNOTIFY_TOUCH_FOUND)
 					{
-						if (pairs[i].triggerActor->getName() == "tree_trigger" && pairs[i].otherActor->getName() == "player")
+						if (IsNamed(pairs[i].triggerActor, "tree_trigger") && IsNamed(pairs[i].otherActor, "player"))
 						{
 							std::cout << "CONTACTTT" << std::endl;
 							cerr << "onTrigger::eNOTIFY_TOUCH_FOUND - chainsaw" << endl;
@@ -86,7 +112,7 @@ namespace PhysicsEngine
 					//check if eNOTIFY_TOUCH_LOST trigger
 					if (pairs[i].status & PxPairFlag::eNOTIFY_TOUCH_LOST)
 					{
-						if (pairs[i].triggerActor->getName() == "tree_trigger" && pairs[i].otherActor->getName() == "player")
+						if (IsNamed(pairs[i].triggerActor, "tree_trigger") && IsNamed(pairs[i].otherActor, "player"))
 						{
 							cerr << "onTrigger::eNOTIFY_TOUCH_LOST - chainsaw" << endl;
 							chainsawTrigger = true;
@@ -132,8 +158,42 @@ namespace PhysicsEngine
 		}
 
 		virtual void onConstraintBreak(PxConstraintInfo *constraints, PxU32 count) {}
-		virtual void onWake(PxActor **actors, PxU32 count) {}
-		virtual void onSleep(PxActor **actors, PxU32 count) {}
+
+		//keep the last change of an actor: move it from the other list (the last one takes its place)
+		void SleepChange(PxActor* actor, bool awake)
+		{
+			unordered_map<PxActor*, pair<bool, size_t> >::iterator it = sleep_changes.find(actor);
+			if (it != sleep_changes.end())
+			{
+				if (it->second.first == awake)
+					return;
+				vector<PxActor*>& from = it->second.first ? woken : slept;
+				size_t index = it->second.second;
+				from[index] = from.back();
+				sleep_changes[from[index]].second = index;
+				from.pop_back();
+			}
+
+			vector<PxActor*>& to = awake ? woken : slept;
+			sleep_changes[actor] = make_pair(awake, to.size());
+			to.push_back(actor);
+		}
+
+		virtual void onWake(PxActor **actors, PxU32 count)
+		{
+			if (!sleepEvents)
+				return;
+			for (PxU32 i = 0; i < count; i++)
+				SleepChange(actors[i], true);
+		}
+
+		virtual void onSleep(PxActor **actors, PxU32 count)
+		{
+			if (!sleepEvents)
+				return;
+			for (PxU32 i = 0; i < count; i++)
+				SleepChange(actors[i], false);
+		}
 #if PX_PHYSICS_VERSION >= 0x304000
 		virtual void onAdvance(const PxRigidBody *const *bodyBuffer, const PxTransform *poseBuffer, const PxU32 count) {}
 #endif
@@ -182,10 +242,27 @@ namespace PhysicsEngine
 
 		PxRigidDynamic* m_treeHouseRB;
 		Emitter* m_sawdustEmitter;
+		ParticleBackend m_sawdustBackend;
 		MySimulationEventCallback* my_callback;
 		bool m_isBroken;
 		float m_timeElapsed;
 		bool m_timeStarted;
+		bool m_sleepEvents;
+		bool m_visualisation;
+		//total time spent breaking the house (in seconds)
+		double m_breakTime;
+
+		enum InputMode
+		{
+			INPUT_LIVE,
+			INPUT_RECORD,
+			INPUT_REPLAY
+		};
+
+		//recorded or replayed commands
+		InputRecorder m_input;
+		InputMode m_inputMode;
+		PxReal m_forceStrength;
 		
 	public:
 		vector<RC_Cylinder*> logs;
@@ -193,12 +270,16 @@ namespace PhysicsEngine
 		PxMaterial* wood = CreateMaterial(PxReal(0.54f), PxReal(0.32f), PxReal(0.1f));
 		//specify your custom filter shader here
 		//PxDefaultSimulationFilterShader by default
-		MyScene() : Scene(CustomFilterShader), m_sawdustEmitter(nullptr) {};
+		MyScene(const SceneConfig& config=SceneConfig()) : Scene(CustomFilterShader, config), m_sawdustEmitter(nullptr),
+			m_sawdustBackend(CLOUD_PARTICLES), my_callback(0), m_sleepEvents(false), m_visualisation(true), m_breakTime(0.), m_inputMode(INPUT_LIVE), m_forceStrength(20.f) {};
+
+		///Has the tree house been broken into pieces
+		bool HouseBroken() { return m_isBroken; }
 
 		///A custom scene class
 		void SetVisualisation()
 		{
-			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, 1.0f);
+			px_scene->setVisualizationParameter(PxVisualizationParameter::eSCALE, m_visualisation ? 1.0f : 0.0f);
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eCOLLISION_SHAPES, 1.0f);
 			px_scene->setVisualizationParameter(PxVisualizationParameter::eJOINT_LOCAL_FRAMES, 1.0f);	
 		}
@@ -209,10 +290,20 @@ namespace PhysicsEngine
 		{
 			SetVisualisation();
 
+			m_isBroken = false;
+			m_timeStarted = false;
+			m_timeElapsed = 0.f;
+			m_inputMode = INPUT_LIVE;
+			//a reset without a snapshot has deleted the debris and sawdust
+			logs.clear();
+			m_sawdustEmitter = nullptr;
+
 			GetMaterial()->setDynamicFriction(.2f);
 
 			///Initialise and set the customised event callback
+			delete my_callback;
 			my_callback = new MySimulationEventCallback();
+			my_callback->sleepEvents = m_sleepEvents;
 			px_scene->setSimulationEventCallback(my_callback);
 
 			PxFilterData groundFilterData;
@@ -315,8 +406,36 @@ namespace PhysicsEngine
 			Add(m_curtain);
 		}
 
+		//Custom restore: the debris and sawdust were created after the snapshot and have been deleted
+		virtual void CustomRestore()
+		{
+			logs.clear();
+			m_sawdustEmitter = nullptr;
+
+			m_isBroken = false;
+			m_timeStarted = false;
+			m_timeElapsed = 0.f;
+
+			my_callback->trigger = false;
+			my_callback->fallen = false;
+			my_callback->chainsawTrigger = false;
+			//the actors have been released
+			my_callback->ClearSleepChanges();
+
+			m_treeHouseRB = m_house->Get()->is<PxRigidDynamic>();
+
+			//the recorded steps do not match after a reset
+			if (m_inputMode != INPUT_LIVE)
+			{
+				cerr << (m_inputMode == INPUT_RECORD ? "Recording" : "Replay") << " stopped by a reset" << endl;
+				m_inputMode = INPUT_LIVE;
+			}
+		}
+
 		void BreakHouse()
 		{
+			PROFILE_ZONE("MyScene::BreakHouse");
+
 			float logLength = 3.0f;
 			float logRadius = 0.1f;
 			float density = 300.0f;
@@ -385,10 +504,14 @@ namespace PhysicsEngine
 		//Custom udpate function
 		virtual void CustomUpdate(float dt) 
 		{
+			PROFILE_ZONE("MyScene::CustomUpdate");
+
 			if (my_callback->fallen && !m_isBroken)
 			{
 				m_isBroken = true;
+				std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
 				BreakHouse();
+				m_breakTime += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
 			}
 			
 			if (my_callback->chainsawTrigger && m_tree->getTrunkParts().size() > 0)
@@ -413,8 +536,17 @@ namespace PhysicsEngine
 					if (!m_sawdustEmitter)
 					{
 						PxTransform emitterPos = PxTransform(PxVec3(10.f, 1.0f, -.5f));
-						m_sawdustEmitter = new Emitter(emitterPos, PxReal(.5f), 500);
+						//about 250 chips alive at a time (each lives 50 updates)
+						m_sawdustEmitter = new Emitter(emitterPos, PxReal(300.f), PxReal(2.f), 500, m_sawdustBackend);
 						Add(m_sawdustEmitter);
+
+						//the cloud sawdust lands on the ground plane and bounces off the tree, the player and the house
+						if (m_sawdustEmitter->Cloud())
+							m_sawdustEmitter->Cloud()->Gravity(px_scene->getGravity());
+						for (DynamicTreePart* part : m_tree->getTrunkParts())
+							m_sawdustEmitter->AddCollider(part);
+						m_sawdustEmitter->AddCollider(m_player);
+						m_sawdustEmitter->AddCollider(m_house);
 					}
 					else {
 						PxTransform emitterPos = PxTransform(PxVec3(10.f, 1.0f, -.5f));
@@ -424,8 +556,7 @@ namespace PhysicsEngine
 			}
 			else if (m_sawdustEmitter)
 			{
-				Remove(m_sawdustEmitter);
-				m_sawdustEmitter = nullptr;
+				ReleaseEmitter();
 			}
 
 			if (m_sawdustEmitter)
@@ -446,6 +577,191 @@ namespace PhysicsEngine
 				}
 				m_sawdustEmitter->ClearDeadParticles();
 			}
+
+			//commands recorded before the next step
+			if (m_inputMode == INPUT_REPLAY)
+				ReplayInput();
+		}
+
+		///Apply a user command, it is recorded when recording and ignored during a replay
+		void Execute(InputCommand command)
+		{
+			if (m_inputMode == INPUT_REPLAY)
+				return;
+
+			if (m_inputMode == INPUT_RECORD)
+				m_input.Record(Step(), command);
+
+			Apply(command);
+		}
+
+		///Reset the scene and record all commands from the first step
+		void StartRecording()
+		{
+			Reset();
+
+			PxU32 seed = (PxU32)time(0);
+			srand(seed);
+			m_input.Clear(seed);
+			m_inputMode = INPUT_RECORD;
+		}
+
+		///Stop recording, returns the recorded commands
+		const InputRecorder& StopRecording()
+		{
+			if (m_inputMode == INPUT_RECORD)
+				m_inputMode = INPUT_LIVE;
+			return m_input;
+		}
+
+		///Reset the scene and apply the commands at the steps they were recorded at
+		void StartReplay(const InputRecorder& input)
+		{
+			Reset();
+
+			m_input = input;
+			m_input.Rewind();
+			srand(m_input.Seed());
+			m_inputMode = INPUT_REPLAY;
+
+			//commands applied before the first step
+			ReplayInput();
+		}
+
+		bool Recording() { return m_inputMode == INPUT_RECORD; }
+
+		bool Replaying() { return m_inputMode == INPUT_REPLAY; }
+
+		///Apply the commands due before the next step
+		void ReplayInput()
+		{
+			InputCommand command;
+			while (m_input.Next(Step(), command))
+				Apply(command);
+
+			if (m_input.Finished())
+			{
+				cerr << "Replay finished at step " << Step() << endl;
+				m_inputMode = INPUT_LIVE;
+			}
+		}
+
+		void Apply(InputCommand command)
+		{
+			PxRigidDynamic* actor = GetSelectedActor();
+
+			switch (command)
+			{
+			case MOVE_LEFT:
+				MovePlayerLeft();
+				break;
+			case MOVE_RIGHT:
+				MovePlayerRight();
+				break;
+			case MOVE_UP:
+				MovePlayerUp();
+				break;
+			case MOVE_DOWN:
+				MovePlayerDown();
+				break;
+			case FORCE_FORWARD:
+				if (actor) actor->addForce(PxVec3(0,0,-1)*m_forceStrength);
+				break;
+			case FORCE_BACKWARD:
+				if (actor) actor->addForce(PxVec3(0,0,1)*m_forceStrength);
+				break;
+			case FORCE_LEFT:
+				if (actor) actor->addForce(PxVec3(-1,0,0)*m_forceStrength);
+				break;
+			case FORCE_RIGHT:
+				if (actor) actor->addForce(PxVec3(1,0,0)*m_forceStrength);
+				break;
+			case FORCE_UP:
+				if (actor) actor->addForce(PxVec3(0,10,0)*m_forceStrength);
+				break;
+			case FORCE_DOWN:
+				if (actor) actor->addForce(PxVec3(0,-1,0)*m_forceStrength);
+				break;
+			case SELECT_NEXT:
+				SelectNextActor();
+				break;
+			default:
+				break;
+			}
+		}
+
+		///Remove the sawdust emitter and release it with its particle pool
+		void ReleaseEmitter()
+		{
+			ParticlePoolStats stats = m_sawdustEmitter->Stats();
+			cout << "Sawdust pool: " << stats.allocated << "/" << stats.capacity << " particles allocated, "
+				<< stats.emitted << " emitted (" << stats.recycled << " recycled, " << stats.dropped << " dropped)" << endl;
+
+			//the live particles are released with the pool
+			for (Particle* part : m_sawdustEmitter->getParticles())
+				if (part->inScene)
+					Remove(part);
+
+			PxActor* emitter = m_sawdustEmitter->Get();
+			Remove(m_sawdustEmitter);
+			delete m_sawdustEmitter;
+			emitter->release();
+			m_sawdustEmitter = nullptr;
+		}
+
+		///Sawdust particles simulated outside of PhysX (nullptr if there is no emitter)
+		ParticleCloud* Sawdust()
+		{
+			return m_sawdustEmitter ? m_sawdustEmitter->Cloud() : nullptr;
+		}
+
+		///PhysX particle system of the sawdust (nullptr if there is no emitter or it uses another backend)
+		PxParticleSystem* SawdustParticleSystem()
+		{
+			return m_sawdustEmitter ? m_sawdustEmitter->ParticleSystem() : nullptr;
+		}
+
+		///How the sawdust is simulated, used by the next emitter (CLOUD_PARTICLES by default)
+		void SawdustBackend(ParticleBackend backend)
+		{
+			m_sawdustBackend = backend;
+		}
+
+		///Generate the debug render data in every step (on by default), the scene must not be simulating
+		void Visualisation(bool value)
+		{
+			m_visualisation = value;
+			SetVisualisation();
+		}
+
+		///Total time spent breaking the house (in seconds), part of the update time
+		double BreakTime() { return m_breakTime; }
+
+		///Collect the actors woken up and put to sleep by the simulation (off by default)
+		void SleepEvents(bool value)
+		{
+			m_sleepEvents = value;
+			my_callback->sleepEvents = value;
+		}
+
+		///Actors woken up since the last ClearSleepEvents
+		const vector<PxActor*>& WokenActors() { return my_callback->woken; }
+
+		///Actors put to sleep since the last ClearSleepEvents
+		const vector<PxActor*>& SleptActors() { return my_callback->slept; }
+
+		void ClearSleepEvents()
+		{
+			my_callback->ClearSleepChanges();
+		}
+
+		///Occupancy of the sawdust particle pool (false if there is no emitter)
+		bool SawdustStats(ParticlePoolStats& stats)
+		{
+			if (!m_sawdustEmitter)
+				return false;
+			stats = m_sawdustEmitter->Stats();
+			return true;
 		}
 
 		/// An example use of key release handling
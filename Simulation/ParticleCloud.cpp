@@ -0,0 +1,431 @@
+#include "ParticleCloud.h"
+
+//SIMD width: 8 with AVX (/arch:AVX), 4 with SSE (always available on x64), scalar otherwise
+#if defined(__AVX__)
+#include <immintrin.h>
+#define PARTICLE_SIMD 8
+#elif defined(_M_X64) || defined(__SSE__) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 1))
+#include <xmmintrin.h>
+#define PARTICLE_SIMD 4
+#else
+#define PARTICLE_SIMD 0
+#endif
+
+namespace PhysicsEngine
+{
+	namespace
+	{
+#if PARTICLE_SIMD == 8
+		typedef __m256 vreal;
+		inline vreal vload(const PxReal* p) { return _mm256_loadu_ps(p); }
+		inline void vstore(PxReal* p, vreal v) { _mm256_storeu_ps(p, v); }
+		inline vreal vset(PxReal x) { return _mm256_set1_ps(x); }
+		inline vreal vadd(vreal a, vreal b) { return _mm256_add_ps(a, b); }
+		inline vreal vsub(vreal a, vreal b) { return _mm256_sub_ps(a, b); }
+		inline vreal vmul(vreal a, vreal b) { return _mm256_mul_ps(a, b); }
+		inline vreal vmin(vreal a, vreal b) { return _mm256_min_ps(a, b); }
+		inline vreal vmax(vreal a, vreal b) { return _mm256_max_ps(a, b); }
+		inline vreal vless(vreal a, vreal b) { return _mm256_cmp_ps(a, b, _CMP_LT_OQ); }
+		inline vreal vand(vreal a, vreal b) { return _mm256_and_ps(a, b); }
+		//a where the mask is set, b elsewhere
+		inline vreal vselect(vreal mask, vreal a, vreal b) { return _mm256_blendv_ps(b, a, mask); }
+		inline int vmask(vreal mask) { return _mm256_movemask_ps(mask); }
+#elif PARTICLE_SIMD == 4
+		typedef __m128 vreal;
+		inline vreal vload(const PxReal* p) { return _mm_loadu_ps(p); }
+		inline void vstore(PxReal* p, vreal v) { _mm_storeu_ps(p, v); }
+		inline vreal vset(PxReal x) { return _mm_set1_ps(x); }
+		inline vreal vadd(vreal a, vreal b) { return _mm_add_ps(a, b); }
+		inline vreal vsub(vreal a, vreal b) { return _mm_sub_ps(a, b); }
+		inline vreal vmul(vreal a, vreal b) { return _mm_mul_ps(a, b); }
+		inline vreal vmin(vreal a, vreal b) { return _mm_min_ps(a, b); }
+		inline vreal vmax(vreal a, vreal b) { return _mm_max_ps(a, b); }
+		inline vreal vless(vreal a, vreal b) { return _mm_cmplt_ps(a, b); }
+		inline vreal vand(vreal a, vreal b) { return _mm_and_ps(a, b); }
+		//a where the mask is set, b elsewhere (no blend before SSE4.1)
+		inline vreal vselect(vreal mask, vreal a, vreal b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		inline int vmask(vreal mask) { return _mm_movemask_ps(mask); }
+#endif
+
+#if PARTICLE_SIMD
+		//smallest of the lanes
+		inline PxReal vreduce_min(vreal v)
+		{
+			PxReal lanes[PARTICLE_SIMD];
+			vstore(lanes, v);
+			PxReal result = lanes[0];
+			for (int k = 1; k < PARTICLE_SIMD; k++)
+				result = PxMin(result, lanes[k]);
+			return result;
+		}
+
+		//largest of the lanes
+		inline PxReal vreduce_max(vreal v)
+		{
+			PxReal lanes[PARTICLE_SIMD];
+			vstore(lanes, v);
+			PxReal result = lanes[0];
+			for (int k = 1; k < PARTICLE_SIMD; k++)
+				result = PxMax(result, lanes[k]);
+			return result;
+		}
+#endif
+
+		//particles integrated and collided together (7 arrays of 4KB stay in the L1 cache)
+		const PxU32 block_size = 1024;
+
+		//sliding speed below which a particle in contact stops
+		const PxReal still_speed = 1e-3f;
+
+		//split the velocity into the normal and tangent part and bounce it off a surface,
+		//only when moving into the surface
+		inline void Bounce(PxVec3& velocity, const PxVec3& normal, PxReal restitution, PxReal friction)
+		{
+			PxReal vn = velocity.dot(normal);
+			if (vn >= 0.f)
+				return;
+
+			PxVec3 tangent = velocity - normal * vn;
+			if (tangent.magnitudeSquared() < still_speed * still_speed)
+				velocity = normal * (-vn * restitution);
+			else
+				velocity = tangent * friction - normal * (vn * restitution);
+		}
+	}
+
+	ParticleCloud::ParticleCloud(PxU32 _capacity, PxReal _radius)
+		: count(0), capacity(_capacity), radius(_radius), ground(0.f), gravity(0.f, -9.81f, 0.f),
+		restitution(.2f), friction(.6f)
+	{
+		px.resize(capacity); py.resize(capacity); pz.resize(capacity);
+		vx.resize(capacity); vy.resize(capacity); vz.resize(capacity);
+		life.resize(capacity);
+		points.reserve(capacity);
+	}
+
+	bool ParticleCloud::Emit(const PxVec3& position, const PxVec3& velocity, PxReal lifetime)
+	{
+		if (count >= capacity)
+			return false;
+
+		px[count] = position.x; py[count] = position.y; pz[count] = position.z;
+		vx[count] = velocity.x; vy[count] = velocity.y; vz[count] = velocity.z;
+		life[count] = lifetime;
+		count++;
+		return true;
+	}
+
+	void ParticleCloud::Step(PxReal dt)
+	{
+		bool any_dead = false;
+
+		//particles are processed in blocks that stay in the L1 cache for the integration and all contacts,
+		//neighbouring particles were emitted close in time and space so the block bounds cull most proxies
+		for (PxU32 begin = 0; begin < count; begin += block_size)
+		{
+			PxU32 end = PxMin(begin + block_size, count);
+
+			PxBounds3 bounds;
+			Integrate(begin, end, dt, bounds, any_dead);
+
+			for (const ParticleSphere& sphere : spheres)
+			{
+				PxReal reach = sphere.radius + radius;
+				if ((sphere.center.x + reach >= bounds.minimum.x) && (sphere.center.x - reach <= bounds.maximum.x) &&
+					(sphere.center.y + reach >= bounds.minimum.y) && (sphere.center.y - reach <= bounds.maximum.y) &&
+					(sphere.center.z + reach >= bounds.minimum.z) && (sphere.center.z - reach <= bounds.maximum.z))
+					Collide(sphere, begin, end);
+			}
+
+			for (const ParticleBox& box : boxes)
+			{
+				if ((box.maximum.x + radius >= bounds.minimum.x) && (box.minimum.x - radius <= bounds.maximum.x) &&
+					(box.maximum.y + radius >= bounds.minimum.y) && (box.minimum.y - radius <= bounds.maximum.y) &&
+					(box.maximum.z + radius >= bounds.minimum.z) && (box.minimum.z - radius <= bounds.maximum.z))
+					Collide(box, begin, end);
+			}
+		}
+
+		if (any_dead)
+			Compact();
+	}
+
+	//semi-implicit Euler step, ground contact and lifetime in a single pass over the arrays,
+	//also gets the bounds of the block (before the proxy contacts) for culling the proxies
+	void ParticleCloud::Integrate(PxU32 begin, PxU32 end, PxReal dt, PxBounds3& bounds, bool& any_dead)
+	{
+		PxReal* x = &px[0]; PxReal* y = &py[0]; PxReal* z = &pz[0];
+		PxReal* ux = &vx[0]; PxReal* uy = &vy[0]; PxReal* uz = &vz[0];
+		PxReal* l = &life[0];
+
+		PxReal floor = ground + radius;
+		PxVec3 lo(PX_MAX_F32), hi(-PX_MAX_F32);
+		int dead = 0;
+		PxU32 i = begin;
+
+#if PARTICLE_SIMD
+		const vreal v_dt = vset(dt), v_floor = vset(floor), v_zero = vset(0.f);
+		const vreal v_restitution = vset(-restitution), v_friction = vset(friction), v_still = vset(still_speed * still_speed);
+		const vreal v_gx = vset(gravity.x * dt), v_gy = vset(gravity.y * dt), v_gz = vset(gravity.z * dt);
+		vreal v_lox = vset(PX_MAX_F32), v_loy = v_lox, v_loz = v_lox;
+		vreal v_hix = vset(-PX_MAX_F32), v_hiy = v_hix, v_hiz = v_hix;
+
+		for (; i + PARTICLE_SIMD <= end; i += PARTICLE_SIMD)
+		{
+			vreal v_ux = vadd(vload(ux + i), v_gx);
+			vreal v_uy = vadd(vload(uy + i), v_gy);
+			vreal v_uz = vadd(vload(uz + i), v_gz);
+			vreal v_x = vadd(vload(x + i), vmul(v_ux, v_dt));
+			vreal v_y = vadd(vload(y + i), vmul(v_uy, v_dt));
+			vreal v_z = vadd(vload(z + i), vmul(v_uz, v_dt));
+			vreal v_l = vsub(vload(l + i), v_dt);
+
+			//ground plane
+			vreal below = vless(v_y, v_floor);
+			v_y = vselect(below, v_floor, v_y);
+			v_uy = vselect(vand(below, vless(v_uy, v_zero)), vmul(v_uy, v_restitution), v_uy);
+			v_ux = vselect(below, vmul(v_ux, v_friction), v_ux);
+			v_uz = vselect(below, vmul(v_uz, v_friction), v_uz);
+			//stop sliding particles before the friction decays the velocity into denormals (very slow)
+			vreal still = vand(below, vless(vadd(vmul(v_ux, v_ux), vmul(v_uz, v_uz)), v_still));
+			v_ux = vselect(still, v_zero, v_ux);
+			v_uz = vselect(still, v_zero, v_uz);
+
+			vstore(x + i, v_x); vstore(y + i, v_y); vstore(z + i, v_z);
+			vstore(ux + i, v_ux); vstore(uy + i, v_uy); vstore(uz + i, v_uz);
+			vstore(l + i, v_l);
+
+			v_lox = vmin(v_lox, v_x); v_loy = vmin(v_loy, v_y); v_loz = vmin(v_loz, v_z);
+			v_hix = vmax(v_hix, v_x); v_hiy = vmax(v_hiy, v_y); v_hiz = vmax(v_hiz, v_z);
+			dead |= vmask(vless(v_l, v_zero));
+		}
+
+		if (i > begin)
+		{
+			lo = PxVec3(vreduce_min(v_lox), vreduce_min(v_loy), vreduce_min(v_loz));
+			hi = PxVec3(vreduce_max(v_hix), vreduce_max(v_hiy), vreduce_max(v_hiz));
+		}
+#endif
+
+		//the remaining particles (or all of them without SIMD)
+		for (; i < end; i++)
+		{
+			ux[i] += gravity.x * dt; uy[i] += gravity.y * dt; uz[i] += gravity.z * dt;
+			x[i] += ux[i] * dt; y[i] += uy[i] * dt; z[i] += uz[i] * dt;
+			l[i] -= dt;
+
+			if (y[i] < floor)
+			{
+				y[i] = floor;
+				if (uy[i] < 0.f)
+					uy[i] *= -restitution;
+				ux[i] *= friction;
+				uz[i] *= friction;
+				if (ux[i] * ux[i] + uz[i] * uz[i] < still_speed * still_speed)
+					ux[i] = uz[i] = 0.f;
+			}
+
+			lo.x = PxMin(lo.x, x[i]); lo.y = PxMin(lo.y, y[i]); lo.z = PxMin(lo.z, z[i]);
+			hi.x = PxMax(hi.x, x[i]); hi.y = PxMax(hi.y, y[i]); hi.z = PxMax(hi.z, z[i]);
+			dead |= (l[i] < 0.f);
+		}
+
+		bounds.minimum = lo;
+		bounds.maximum = hi;
+		any_dead = any_dead || (dead != 0);
+	}
+
+	//find the particles inside the sphere in SIMD, push them out one by one (contacts are rare)
+	void ParticleCloud::Collide(const ParticleSphere& sphere, PxU32 begin, PxU32 end)
+	{
+		PxReal reach = sphere.radius + radius;
+
+		struct Contact
+		{
+			ParticleCloud& cloud;
+			const ParticleSphere& sphere;
+			PxReal reach;
+
+			void Resolve(PxU32 j)
+			{
+				PxVec3 normal(cloud.px[j] - sphere.center.x, cloud.py[j] - sphere.center.y, cloud.pz[j] - sphere.center.z);
+				PxReal distance = normal.magnitude();
+				normal = (distance > 1e-6f) ? normal * (1.f / distance) : PxVec3(0.f, 1.f, 0.f);
+
+				PxVec3 position = sphere.center + normal * reach;
+				PxVec3 velocity(cloud.vx[j], cloud.vy[j], cloud.vz[j]);
+				Bounce(velocity, normal, cloud.restitution, cloud.friction);
+
+				cloud.px[j] = position.x; cloud.py[j] = position.y; cloud.pz[j] = position.z;
+				cloud.vx[j] = velocity.x; cloud.vy[j] = velocity.y; cloud.vz[j] = velocity.z;
+			}
+		} contact = { *this, sphere, reach };
+
+		PxU32 i = begin;
+
+#if PARTICLE_SIMD
+		const vreal v_cx = vset(sphere.center.x), v_cy = vset(sphere.center.y), v_cz = vset(sphere.center.z);
+		const vreal v_reach2 = vset(reach * reach);
+
+		for (; i + PARTICLE_SIMD <= end; i += PARTICLE_SIMD)
+		{
+			vreal dx = vsub(vload(&px[i]), v_cx);
+			vreal dy = vsub(vload(&py[i]), v_cy);
+			vreal dz = vsub(vload(&pz[i]), v_cz);
+			vreal d2 = vadd(vadd(vmul(dx, dx), vmul(dy, dy)), vmul(dz, dz));
+
+			int hits = vmask(vless(d2, v_reach2));
+			for (int k = 0; hits; k++, hits >>= 1)
+				if (hits & 1)
+					contact.Resolve(i + k);
+		}
+#endif
+
+		for (; i < end; i++)
+		{
+			PxReal dx = px[i] - sphere.center.x, dy = py[i] - sphere.center.y, dz = pz[i] - sphere.center.z;
+			if (dx * dx + dy * dy + dz * dz < reach * reach)
+				contact.Resolve(i);
+		}
+	}
+
+	//find the particles inside the box in SIMD, push them out through the nearest face
+	void ParticleCloud::Collide(const ParticleBox& box, PxU32 begin, PxU32 end)
+	{
+		PxVec3 lo = box.minimum - PxVec3(radius), hi = box.maximum + PxVec3(radius);
+
+		struct Contact
+		{
+			ParticleCloud& cloud;
+			PxVec3 lo, hi;
+
+			void Resolve(PxU32 j)
+			{
+				PxReal* position[3] = { &cloud.px[j], &cloud.py[j], &cloud.pz[j] };
+
+				//the face with the smallest penetration
+				PxU32 axis = 0;
+				PxReal depth = PX_MAX_F32, face = 0.f, side = 0.f;
+				for (PxU32 a = 0; a < 3; a++)
+				{
+					PxReal to_lo = *position[a] - lo[a], to_hi = hi[a] - *position[a];
+					if (to_lo < depth) { depth = to_lo; axis = a; face = lo[a]; side = -1.f; }
+					if (to_hi < depth) { depth = to_hi; axis = a; face = hi[a]; side = 1.f; }
+				}
+
+				PxVec3 normal(0.f);
+				normal[axis] = side;
+				PxVec3 velocity(cloud.vx[j], cloud.vy[j], cloud.vz[j]);
+				Bounce(velocity, normal, cloud.restitution, cloud.friction);
+
+				*position[axis] = face;
+				cloud.vx[j] = velocity.x; cloud.vy[j] = velocity.y; cloud.vz[j] = velocity.z;
+			}
+		} contact = { *this, lo, hi };
+
+		PxU32 i = begin;
+
+#if PARTICLE_SIMD
+		const vreal v_lox = vset(lo.x), v_loy = vset(lo.y), v_loz = vset(lo.z);
+		const vreal v_hix = vset(hi.x), v_hiy = vset(hi.y), v_hiz = vset(hi.z);
+
+		for (; i + PARTICLE_SIMD <= end; i += PARTICLE_SIMD)
+		{
+			vreal v_x = vload(&px[i]), v_y = vload(&py[i]), v_z = vload(&pz[i]);
+			vreal inside = vand(vand(vless(v_lox, v_x), vless(v_x, v_hix)),
+				vand(vand(vless(v_loy, v_y), vless(v_y, v_hiy)), vand(vless(v_loz, v_z), vless(v_z, v_hiz))));
+
+			int hits = vmask(inside);
+			for (int k = 0; hits; k++, hits >>= 1)
+				if (hits & 1)
+					contact.Resolve(i + k);
+		}
+#endif
+
+		for (; i < end; i++)
+		{
+			if ((lo.x < px[i]) && (px[i] < hi.x) && (lo.y < py[i]) && (py[i] < hi.y) && (lo.z < pz[i]) && (pz[i] < hi.z))
+				contact.Resolve(i);
+		}
+	}
+
+	//move the last live particle into each expired slot, the order does not matter
+	void ParticleCloud::Compact()
+	{
+		for (PxU32 i = 0; i < count;)
+		{
+			if (life[i] < 0.f)
+			{
+				count--;
+				px[i] = px[count]; py[i] = py[count]; pz[i] = pz[count];
+				vx[i] = vx[count]; vy[i] = vy[count]; vz[i] = vz[count];
+				life[i] = life[count];
+			}
+			else
+				i++;
+		}
+	}
+
+	void ParticleCloud::ClearColliders()
+	{
+		spheres.clear();
+		boxes.clear();
+	}
+
+	void ParticleCloud::AddSphere(const PxVec3& center, PxReal sphere_radius)
+	{
+		ParticleSphere sphere = { center, sphere_radius };
+		spheres.push_back(sphere);
+	}
+
+	void ParticleCloud::AddBox(const PxBounds3& bounds)
+	{
+		ParticleBox box = { bounds.minimum, bounds.maximum };
+		boxes.push_back(box);
+	}
+
+	void ParticleCloud::AddCollider(const PxRigidActor& actor)
+	{
+		PxShape* shapes[16];
+		PxU32 nb_shapes = actor.getNbShapes();
+		for (PxU32 start = 0; start < nb_shapes; start += 16)
+		{
+			PxU32 n = actor.getShapes(shapes, 16, start);
+			for (PxU32 i = 0; i < n; i++)
+			{
+				const PxShape& shape = *shapes[i];
+				if (shape.getFlags() & PxShapeFlag::eTRIGGER_SHAPE)
+					continue;
+
+				switch (shape.getGeometryType())
+				{
+				case PxGeometryType::ePLANE:
+					break;
+				case PxGeometryType::eSPHERE:
+				{
+					PxSphereGeometry sphere;
+					shape.getSphereGeometry(sphere);
+					AddSphere(PxShapeExt::getGlobalPose(shape, actor).p, sphere.radius);
+					break;
+				}
+				default:
+					AddBox(PxShapeExt::getWorldBounds(shape, actor, 1.f));
+					break;
+				}
+			}
+		}
+	}
+
+	PxU32 ParticleCloud::SimdWidth()
+	{
+		return PARTICLE_SIMD ? PARTICLE_SIMD : 1;
+	}
+
+	const std::vector<PxVec3>& ParticleCloud::Positions()
+	{
+		points.resize(count);
+		for (PxU32 i = 0; i < count; i++)
+			points[i] = PxVec3(px[i], py[i], pz[i]);
+		return points;
+	}
+}
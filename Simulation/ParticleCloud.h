@@ -0,0 +1,98 @@
+#pragma once
+
+#include <vector>
+#include "PxPhysicsAPI.h"
+
+namespace PhysicsEngine
+{
+	using namespace physx;
+
+	///Sphere collision proxy
+	struct ParticleSphere
+	{
+		PxVec3 center;
+		PxReal radius;
+	};
+
+	///Axis-aligned box collision proxy
+	struct ParticleBox
+	{
+		PxVec3 minimum;
+		PxVec3 maximum;
+	};
+
+	///Lightweight particles simulated outside of the PhysX solver.
+	///
+	///Positions, velocities and lifetimes are kept in separate arrays (structure of arrays)
+	///and integrated with SSE (4 particles) or AVX (8 particles, when compiled with /arch:AVX) kernels.
+	///Particles collide with a ground plane and with sphere and box proxies of the scene actors,
+	///they do not collide with each other and do not push the actors.
+	class ParticleCloud
+	{
+		//particle state, the first count elements are alive
+		std::vector<PxReal> px, py, pz;
+		std::vector<PxReal> vx, vy, vz;
+		std::vector<PxReal> life;
+		PxU32 count;
+		PxU32 capacity;
+
+		PxReal radius;
+		PxReal ground;
+		PxVec3 gravity;
+		//velocity kept along the contact normal after a bounce
+		PxReal restitution;
+		//velocity kept along the contact plane after a bounce
+		PxReal friction;
+
+		std::vector<ParticleSphere> spheres;
+		std::vector<ParticleBox> boxes;
+
+		//packed positions for rendering
+		std::vector<PxVec3> points;
+
+		void Integrate(PxU32 begin, PxU32 end, PxReal dt, PxBounds3& bounds, bool& any_dead);
+		void Collide(const ParticleSphere& sphere, PxU32 begin, PxU32 end);
+		void Collide(const ParticleBox& box, PxU32 begin, PxU32 end);
+		void Compact();
+
+	public:
+		ParticleCloud(PxU32 _capacity, PxReal _radius=.05f);
+
+		///Add a particle, returns false when the cloud is full
+		bool Emit(const PxVec3& position, const PxVec3& velocity, PxReal lifetime);
+
+		///Advance all particles by dt and remove the expired ones
+		void Step(PxReal dt);
+
+		///Remove all particles
+		void Clear() { count = 0; }
+
+		///Remove all collision proxies
+		void ClearColliders();
+
+		void AddSphere(const PxVec3& center, PxReal sphere_radius);
+
+		void AddBox(const PxBounds3& bounds);
+
+		///Add proxies for the shapes of an actor: spheres for sphere shapes and world bounds for the rest
+		///(planes and triggers are skipped, the ground is set with Ground)
+		void AddCollider(const PxRigidActor& actor);
+
+		///Height of the ground plane
+		void Ground(PxReal height) { ground = height; }
+
+		void Gravity(const PxVec3& value) { gravity = value; }
+
+		PxU32 Count() const { return count; }
+
+		PxU32 Capacity() const { return capacity; }
+
+		PxReal Radius() const { return radius; }
+
+		///Particles integrated by a single SIMD instruction (1 without SIMD)
+		static PxU32 SimdWidth();
+
+		///Positions of the live particles
+		const std::vector<PxVec3>& Positions();
+	};
+}
@@ -2,21 +2,25 @@
 
 #include "BasicActors.h"
 #include "PhysicsEngine.h"
+#include "ParticleCloud.h"
 #include "vector"
 #include <iomanip>
+#include <cmath>
 #include <random>
+#include <cstring>
 
 namespace PhysicsEngine
 {
 
 	class Particle : public DynamicActor
 	{
-		float lifeSpan = 100.0f;
+		float lifeSpan;
 	public:
 		bool inScene = false;
-		Particle(PxTransform pose) : DynamicActor(pose)
+		Particle(PxTransform pose, float life=100.0f) : DynamicActor(pose), lifeSpan(life)
 		{
 			CreateShape(PxSphereGeometry(PxReal(0.05f)), 0.05);
+			((UserData*)GetShape(0)->userData)->particle = true;
 		}
 
 		void AddVelocity(PxVec3 v)
@@ -24,6 +28,15 @@ namespace PhysicsEngine
 			Get()->is<PxRigidDynamic>()->setLinearVelocity(v);
 		}
 
+		///Bring a recycled particle back to life (the actor must be out of the scene)
+		void Respawn(const PxTransform& pose, float life=100.0f)
+		{
+			lifeSpan = life;
+			PxRigidDynamic* body = Get()->is<PxRigidDynamic>();
+			body->setGlobalPose(pose);
+			body->setAngularVelocity(PxVec3(0.f));
+		}
+
 		void Update()
 		{
 			lifeSpan -= 2.0f;
@@ -35,32 +48,175 @@ namespace PhysicsEngine
 		}
 	};
 
+	///Particle pool occupancy
+	struct ParticlePoolStats
+	{
+		PxU32 capacity; //hard cap on the particles created
+		PxU32 allocated; //particles created so far
+		PxU32 active; //particles alive
+		PxU32 emitted; //total emitted, including the recycled ones
+		PxU32 recycled; //emitted by reusing a dead particle
+		PxU32 dropped; //not emitted because all particles were alive
+	};
+
+	///How the emitted particles are simulated
+	enum ParticleBackend
+	{
+		RIGID_PARTICLES, //a PhysX rigid body per particle (Particle)
+		CLOUD_PARTICLES, //a ParticleCloud integrated outside of the PhysX solver
+		PHYSX_PARTICLES //a PhysX CPU particle system (PxParticleSystem)
+	};
+
+	///Backend by name: "rigid", "cloud" or "physx" (false if unknown)
+	inline bool ParticleBackendByName(const char* name, ParticleBackend& backend)
+	{
+		static const char* names[] = { "rigid", "cloud", "physx" };
+		for (int i = 0; i < 3; i++)
+		{
+			if (!strcmp(name, names[i]))
+			{
+				backend = (ParticleBackend)i;
+				return true;
+			}
+		}
+		return false;
+	}
+
 	class Emitter : public DynamicActor
 	{
 	private:
+		ParticleBackend m_backend;
+		//particles of the cloud backend
+		ParticleCloud m_cloud;
+		//actors the cloud particles collide with
+		std::vector<Actor*> m_colliders;
+		//number of updates a particle lives
+		PxU32 m_particleUpdates = 50;
+		//lifetime of a cloud particle in seconds (set from the update time step)
+		PxReal m_cloudLifeTime = 50.f / 90.f;
+		//time step of the last update
+		PxReal m_updateTime = 1.f / 90.f;
+		PxU32 m_peakCount = 0;
+
+		//particles of the PhysX backend, the indices come from the pool
+		PxParticleSystem* m_particleSystem = nullptr;
+		PxParticleExt::IndexPool* m_indexPool = nullptr;
+		//live particle indices and their remaining updates
+		std::vector<PxU32> m_liveIndices;
+		std::vector<PxU32> m_liveUpdates;
+		//particles emitted since the last update, created in one batch
+		std::vector<PxU32> m_newIndices;
+		std::vector<PxVec3> m_newPositions;
+		std::vector<PxVec3> m_newVelocities;
+		//expired particles, released in one batch
+		std::vector<PxU32> m_expiredIndices;
+
+		//all particles created (at most m_maxParticles), the emitter owns them
+		std::vector<Particle*> m_pool;
+		//dead particles out of the scene, ready to be reused
+		std::vector<Particle*> m_free;
 		std::vector<Particle*> m_particles;
 		std::vector<Particle*> m_deadParticles;
 		PxTransform m_pos;
 		
+		//particles per second
 		PxReal m_emitRate;
+		//mean speed of an emitted particle (m/s)
+		PxReal m_emitSpeed;
 		int m_maxParticles;
 		int m_numEmitted = 0;
+		PxU32 m_numRecycled = 0;
+		PxU32 m_numDropped = 0;
 
 		float m_timeSinceLastEmit = 0.0f;
 
 	public:
-		Emitter(PxTransform pose, PxReal rate, int maxParticles) 
-			: DynamicActor(pose), m_pos(pose), m_emitRate(rate), m_maxParticles(maxParticles)
+		///rate - particles per second, speed - mean speed of the particles (m/s)
+		Emitter(PxTransform pose, PxReal rate, PxReal speed, int maxParticles, ParticleBackend backend=CLOUD_PARTICLES)
+			: DynamicActor(pose), m_backend(backend), m_cloud(backend == CLOUD_PARTICLES ? maxParticles : 0),
+			m_pos(pose), m_emitRate(rate), m_emitSpeed(speed), m_maxParticles(maxParticles)
 		{
 			CreateShape(PxBoxGeometry(PxVec3(.01f, .01f, .01f)), 1.0f);
 			SetKinematic(true);
+			if (m_backend == RIGID_PARTICLES)
+			{
+				m_pool.reserve(maxParticles);
+				m_free.reserve(maxParticles);
+				m_particles.reserve(maxParticles);
+			}
+			else if (m_backend == PHYSX_PARTICLES)
+			{
+				m_particleSystem = GetPhysics()->createParticleSystem(maxParticles);
+				if (!m_particleSystem)
+					throw new Exception("Emitter::Emitter, could not create the particle system.");
+				m_indexPool = PxParticleExt::createIndexPool(maxParticles);
+
+				//5cm chips like the rigid particles, colliding one-way with the static and dynamic actors
+				m_particleSystem->setRestOffset(.05f);
+				m_particleSystem->setContactOffset(.1f);
+				m_particleSystem->setGridSize(2.f);
+				m_particleSystem->setMaxMotionDistance(.5f);
+				m_particleSystem->setRestitution(.2f);
+				m_particleSystem->setDynamicFriction(.6f);
+				m_particleSystem->setParticleBaseFlag(PxParticleBaseFlag::eCOLLISION_WITH_DYNAMIC_ACTORS, true);
+				m_particleSystem->setParticleBaseFlag(PxParticleBaseFlag::eCOLLISION_TWOWAY, false);
+				m_particleSystem->setParticleReadDataFlag(PxParticleReadDataFlag::ePOSITION_BUFFER, true);
+
+				m_liveIndices.reserve(maxParticles);
+				m_liveUpdates.reserve(maxParticles);
+			}
 		}
 
-		void emit()
+		///Release all particles (the emitter actor itself is released by the owner)
+		~Emitter()
+		{
+			if (m_particleSystem)
+				m_particleSystem->release();
+			if (m_indexPool)
+				m_indexPool->release();
+
+			for (Particle* particle : m_pool)
+			{
+				PxActor* particle_actor = particle->Get();
+				delete particle;
+				if (particle_actor)
+					particle_actor->release();
+			}
+		}
+
+		///Emit a particle, returns false when all particles of the pool are alive
+		bool emit()
 		{
 			PxTransform currPos = Get()->is<PxRigidBody>()->getGlobalPose();
-			Particle* particle = new Particle(currPos);
-			particle->Color(PxVec3(0.6f, 0.4f, 0.2f));
+
+			//reuse a dead particle, create a new one while under the cap
+			Particle* particle = nullptr;
+			PxU32 index = 0;
+			if (m_backend == CLOUD_PARTICLES)
+			{
+				if (m_cloud.Count() >= m_cloud.Capacity())
+					return false;
+			}
+			else if (m_backend == PHYSX_PARTICLES)
+			{
+				if (m_indexPool->allocateIndices(1, PxStrideIterator<PxU32>(&index)) != 1)
+					return false;
+			}
+			else if (m_free.size())
+			{
+				particle = m_free.back();
+				m_free.pop_back();
+				particle->Respawn(currPos, 2.0f * m_particleUpdates);
+				m_numRecycled++;
+			}
+			else if ((int)m_pool.size() < m_maxParticles)
+			{
+				particle = new Particle(currPos, 2.0f * m_particleUpdates);
+				particle->Color(PxVec3(0.6f, 0.4f, 0.2f));
+				m_pool.push_back(particle);
+			}
+			else
+				return false;
 
 			PxVec3 baseDirection(0.0f, 0.3f, 1.0f); // Slight upward and forward
 			baseDirection.normalize();
@@ -78,48 +234,195 @@ namespace PhysicsEngine
 			PxVec3 direction = baseDirection + offset;
 			direction.normalize();
 
-			float speed = m_emitRate * (0.5f + static_cast<float>(rand()) / RAND_MAX);
-			particle->AddVelocity(speed * direction);
-			m_particles.push_back(particle);
+			float speed = m_emitSpeed * (0.5f + static_cast<float>(rand()) / RAND_MAX);
+			if (particle)
+			{
+				particle->AddVelocity(speed * direction);
+				m_particles.push_back(particle);
+			}
+			else if (m_backend == CLOUD_PARTICLES)
+			{
+				m_cloud.Emit(currPos.p, speed * direction, m_cloudLifeTime);
+				m_peakCount = PxMax(m_peakCount, m_cloud.Count());
+			}
+			else
+			{
+				m_newIndices.push_back(index);
+				m_newPositions.push_back(currPos.p);
+				m_newVelocities.push_back(speed * direction);
+				m_peakCount = PxMax(m_peakCount, (PxU32)(m_liveIndices.size() + m_newIndices.size()));
+			}
 			m_numEmitted++;
+			return true;
 		}
 
-		std::vector<Particle*> getParticles()
+		const std::vector<Particle*>& getParticles()
 		{
 			return m_particles;
 		}
 
-		std::vector<Particle*> getDeadParticles()
+		const std::vector<Particle*>& getDeadParticles()
 		{
 			return m_deadParticles;
 		}
 
+		///The dead particles have been removed from the scene, put them back in the pool
 		void ClearDeadParticles()
 		{
+			for (Particle* particle : m_deadParticles)
+			{
+				particle->inScene = false;
+				m_free.push_back(particle);
+			}
 			m_deadParticles.clear();
 		}
 
+		///Particles of the cloud backend (nullptr with rigid particles)
+		ParticleCloud* Cloud()
+		{
+			return (m_backend == CLOUD_PARTICLES) ? &m_cloud : nullptr;
+		}
+
+		///PhysX particle system of the PHYSX_PARTICLES backend (nullptr with other backends)
+		PxParticleSystem* ParticleSystem()
+		{
+			return m_particleSystem;
+		}
+
+		///Number of updates a particle lives (50 by default)
+		void ParticleLifetime(PxU32 updates)
+		{
+			m_particleUpdates = updates;
+			//particles emitted before the next update get the new lifetime as well
+			m_cloudLifeTime = m_particleUpdates * m_updateTime;
+		}
+
+		///Add an actor the cloud particles collide with, its proxies follow the actor while it is in a scene
+		void AddCollider(Actor* actor)
+		{
+			m_colliders.push_back(actor);
+		}
+
+		ParticlePoolStats Stats()
+		{
+			if (m_backend != RIGID_PARTICLES)
+			{
+				//a slot of the cloud or an index of the particle system is reused once its particle expires
+				PxU32 active = (m_backend == CLOUD_PARTICLES) ? m_cloud.Count() : (PxU32)m_liveIndices.size();
+				ParticlePoolStats stats = { (PxU32)m_maxParticles, m_peakCount, active,
+					(PxU32)m_numEmitted, (PxU32)m_numEmitted - m_peakCount, m_numDropped };
+				return stats;
+			}
+
+			ParticlePoolStats stats = { (PxU32)m_maxParticles, (PxU32)m_pool.size(), (PxU32)m_particles.size(),
+				(PxU32)m_numEmitted, m_numRecycled, m_numDropped };
+			return stats;
+		}
+
 		void Update(float dt)
 		{
+			PROFILE_ZONE("Emitter::Update");
+
 			m_timeSinceLastEmit += dt;
+			m_updateTime = dt;
+			m_cloudLifeTime = m_particleUpdates * dt;
 
 			int emitCount = int(m_emitRate * m_timeSinceLastEmit);
+			//the time of the particles emitted (or dropped when the pool is full) is consumed, the remainder carries over
+			if (m_emitRate > 0.f)
+				m_timeSinceLastEmit = fmodf(m_timeSinceLastEmit, 1.f / m_emitRate);
 
-			for (int i = 0; i < emitCount && m_numEmitted < m_maxParticles; ++i)
+			for (int i = 0; i < emitCount; ++i)
 			{
-				emit();
+				if (!emit())
+				{
+					m_numDropped += emitCount - i;
+					break;
+				}
 			}
 
+			if (m_backend == CLOUD_PARTICLES)
+			{
+				m_cloud.ClearColliders();
+				for (Actor* actor : m_colliders)
+				{
+					PxRigidActor* rigid_actor = actor->Get()->is<PxRigidActor>();
+					if (rigid_actor && rigid_actor->getScene())
+						m_cloud.AddCollider(*rigid_actor);
+				}
+				m_cloud.Step(dt);
+				return;
+			}
+
+			if (m_backend == PHYSX_PARTICLES)
+			{
+				UpdateParticleSystem();
+				return;
+			}
 
-			for (int i = 0; i < m_particles.size(); ++i)
+			for (size_t i = 0; i < m_particles.size();)
 			{
 				Particle* particle = m_particles[i];
 				if (!particle->isDead()) particle->Update();
 				if (particle->isDead())
 				{
+					//swap with the last one, the order does not matter
 					m_deadParticles.push_back(particle);
-					m_particles.erase(m_particles.begin() + i);
+					m_particles[i] = m_particles.back();
+					m_particles.pop_back();
+				}
+				else
+					++i;
+			}
+		}
+
+	private:
+		//release the expired particles and create the ones emitted since the last update,
+		//the particle system joins the scene of the emitter (it can only be changed between steps)
+		void UpdateParticleSystem()
+		{
+			PxScene* scene = Get()->getScene();
+			if (scene && !m_particleSystem->getScene())
+				scene->addActor(*m_particleSystem);
+			if (!m_particleSystem->getScene())
+				return;
+
+			for (size_t i = 0; i < m_liveIndices.size();)
+			{
+				if (--m_liveUpdates[i] == 0)
+				{
+					m_expiredIndices.push_back(m_liveIndices[i]);
+					m_liveIndices[i] = m_liveIndices.back();
+					m_liveUpdates[i] = m_liveUpdates.back();
+					m_liveIndices.pop_back();
+					m_liveUpdates.pop_back();
 				}
+				else
+					++i;
+			}
+
+			if (m_expiredIndices.size())
+			{
+				PxStrideIterator<const PxU32> indices(&m_expiredIndices[0]);
+				m_particleSystem->releaseParticles((PxU32)m_expiredIndices.size(), indices);
+				m_indexPool->freeIndices((PxU32)m_expiredIndices.size(), indices);
+				m_expiredIndices.clear();
+			}
+
+			if (m_newIndices.size())
+			{
+				PxParticleCreationData data;
+				data.numParticles = (PxU32)m_newIndices.size();
+				data.indexBuffer = PxStrideIterator<const PxU32>(&m_newIndices[0]);
+				data.positionBuffer = PxStrideIterator<const PxVec3>(&m_newPositions[0]);
+				data.velocityBuffer = PxStrideIterator<const PxVec3>(&m_newVelocities[0]);
+				m_particleSystem->createParticles(data);
+
+				m_liveIndices.insert(m_liveIndices.end(), m_newIndices.begin(), m_newIndices.end());
+				m_liveUpdates.insert(m_liveUpdates.end(), m_newIndices.size(), m_particleUpdates);
+				m_newIndices.clear();
+				m_newPositions.clear();
+				m_newVelocities.clear();
 			}
 		}
 	};
@@ -1,6 +1,11 @@
 #include "PhysicsEngine.h"
 #include "CustomActors.h"
 #include <iostream>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <chrono>
+#include <thread>
 
 namespace PhysicsEngine
 {
@@ -21,6 +26,11 @@ namespace PhysicsEngine
 	PxPhysics* physics = 0;
 	PxCooking* cooking = 0;
 
+	//CPU dispatcher shared by all scenes
+	PxDefaultCpuDispatcher* dispatcher = 0;
+	SceneConfig dispatcher_config;
+	PxU32 dispatcher_users = 0;
+
 
 	///PhysX functions
 	void PxInit()
@@ -66,6 +76,9 @@ namespace PhysicsEngine
 		if (!cooking)
 			throw new Exception("PhysicsEngine::PxInit, Could not initialise the cooking component.");
 
+		//meshes cooked by the previous runs
+		OpenMeshPack();
+
 
 		//create a deafult material
 		CreateMaterial();
@@ -77,6 +90,15 @@ namespace PhysicsEngine
 
 	void PxRelease()
 	{
+		if (dispatcher)
+		{
+			dispatcher->release();
+			dispatcher = 0;
+			dispatcher_users = 0;
+		}
+		RC_Cylinder::ReleaseCache();
+		SaveMeshPack();
+		CloseMeshPack();
 		if (cooking)
 			cooking->release();
 		if (physics)
@@ -97,6 +119,68 @@ namespace PhysicsEngine
 		return cooking;
 	}
 
+	PxU32 WorkerThreads(const SceneConfig& config)
+	{
+		if (config.threads)
+			return config.threads;
+
+		//leave one core for the main (render) thread
+		unsigned int cores = std::thread::hardware_concurrency();
+		return (cores > 1) ? (PxU32)cores - 1 : 1;
+	}
+
+	PxDefaultCpuDispatcher* AcquireDispatcher(const SceneConfig& config)
+	{
+		PxU32 threads = WorkerThreads(config);
+
+		//a different config can only be applied when no scene uses the dispatcher
+		if (dispatcher && ((WorkerThreads(dispatcher_config) != threads) || (dispatcher_config.affinity_mask != config.affinity_mask)))
+		{
+			if (dispatcher_users)
+			{
+				cerr << "PhysicsEngine::AcquireDispatcher, the dispatcher is shared by " << dispatcher_users << " scene(s), "
+					<< WorkerThreads(dispatcher_config) << " worker threads are used instead of " << threads << "." << endl;
+			}
+			else
+			{
+				dispatcher->release();
+				dispatcher = 0;
+			}
+		}
+
+		if (!dispatcher)
+		{
+			std::vector<PxU32> affinity;
+			if (config.affinity_mask)
+			{
+				//pin each worker to the next core in the mask
+				std::vector<PxU32> cores;
+				for (PxU32 i = 0; i < 32; i++)
+					if (config.affinity_mask & (1u << i))
+						cores.push_back(1u << i);
+
+				for (PxU32 i = 0; i < threads; i++)
+					affinity.push_back(cores[i % cores.size()]);
+			}
+
+			dispatcher = PxDefaultCpuDispatcherCreate(threads, affinity.size() ? &affinity.front() : NULL);
+			dispatcher_config = config;
+		}
+
+		if (!dispatcher)
+			throw new Exception("PhysicsEngine::AcquireDispatcher, Could not create the CPU dispatcher.");
+
+		dispatcher_users++;
+		return dispatcher;
+	}
+
+	void ReleaseDispatcher()
+	{
+		//the dispatcher itself is kept alive for the next scene and released in PxRelease
+		if (dispatcher_users)
+			dispatcher_users--;
+	}
+
 	PxMaterial* GetMaterial(PxU32 index)
 	{
 		std::vector<PxMaterial*> materials(physics->getNbMaterials());
@@ -113,11 +197,64 @@ namespace PhysicsEngine
 
 	///Actor methods
 
+	//wrapper registries, keys are increasing so the maps keep the creation order
+	PxU64 next_actor_key = 0;
+	PxU64 next_joint_key = 0;
+	//joint wrappers taken over by a scene (the others are not attached to a scene yet)
+	std::set<PxU64> claimed_joints;
+
+	std::map<PxU64, Actor*>& Actor::Registry()
+	{
+		static std::map<PxU64, Actor*> registry;
+		return registry;
+	}
+
+	PxU64 Actor::Register(Actor* wrapper)
+	{
+		Registry()[++next_actor_key] = wrapper;
+		return next_actor_key;
+	}
+
+	Actor::~Actor()
+	{
+		Registry().erase(registry_key);
+	}
+
 	PxActor* Actor::Get()
 	{
 		return actor;
 	}
 
+	void Actor::Rebind(PxActor* new_actor)
+	{
+		if (actor && new_actor)
+		{
+			new_actor->userData = actor->userData;
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+			if (actor->isRigidActor() && new_actor->isRigidActor())
+#else
+			if (actor->is<PxRigidActor>() && new_actor->is<PxRigidActor>())
+#endif
+			{
+				std::vector<PxShape*> new_shapes(((PxRigidActor*)new_actor)->getNbShapes());
+				if (new_shapes.size())
+					((PxRigidActor*)new_actor)->getShapes(&new_shapes.front(), (PxU32)new_shapes.size());
+
+				for (PxU32 i = 0; (i < shapes.size()) && (i < new_shapes.size()); i++)
+					new_shapes[i]->userData = shapes[i]->userData;
+
+				shapes.swap(new_shapes);
+			}
+		}
+
+		actor = new_actor;
+
+		//names set through Name() point to the wrapper string
+		if (actor && name.size())
+			actor->setName(name.c_str());
+	}
+
 	void Actor::Color(PxVec3 new_color, PxU32 shape_index)
 	{
 		//change color of all shapes
@@ -141,56 +278,87 @@ namespace PhysicsEngine
 			return 0;
 	}
 
+	void Actor::ShapeRange(PxU32 shape_index, PxU32& first, PxU32& last)
+	{
+		if (shape_index == -1)
+		{
+			first = 0;
+			last = (PxU32)shapes.size();
+		}
+		else
+		{
+			first = PxMin(shape_index, (PxU32)shapes.size());
+			last = PxMin(shape_index + 1, (PxU32)shapes.size());
+		}
+	}
+
+	void Actor::AddShape(PxShape* shape)
+	{
+		shapes.push_back(shape);
+		colors.push_back(default_color);
+		//pass the color pointer to the renderer
+		shape->userData = new UserData();
+		((UserData*)shape->userData)->color = &colors.back();
+	}
+
+	void Actor::RemoveShape(PxU32 index)
+	{
+		if (index >= shapes.size())
+			return;
+
+		delete (UserData*)shapes[index]->userData;
+		((PxRigidActor*)actor)->detachShape(*shapes[index]);
+		shapes.erase(shapes.begin() + index);
+		colors.erase(colors.begin() + index);
+
+		//erasing from the middle of a deque invalidates the addresses of all its elements
+		for (PxU32 i = 0; i < shapes.size(); i++)
+			((UserData*)shapes[i]->userData)->color = &colors[i];
+	}
+
 	void Actor::Material(PxMaterial* new_material, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
+		PxU32 first, last;
+		ShapeRange(shape_index, first, last);
+		for (PxU32 i = first; i < last; i++)
 		{
-			std::vector<PxMaterial*> materials(shape_list[i]->getNbMaterials());
+			std::vector<PxMaterial*> materials(shapes[i]->getNbMaterials());
 			for (unsigned int j = 0; j < materials.size(); j++)
 				materials[j] = new_material;
-			shape_list[i]->setMaterials(materials.data(), (PxU16)materials.size());
+			shapes[i]->setMaterials(materials.data(), (PxU16)materials.size());
 		}
 	}
 
 	PxShape* Actor::GetShape(PxU32 index)
 	{
-		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
-		if (index < ((PxRigidActor*)actor)->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size()))
+		if (index < shapes.size())
 			return shapes[index];
 		else
 			return 0;
 	}
 
-	std::vector<PxShape*> Actor::GetShapes(PxU32 index)
+	const std::vector<PxShape*>& Actor::GetShapes()
 	{
-		std::vector<PxShape*> shapes(((PxRigidActor*)actor)->getNbShapes());
-		((PxRigidActor*)actor)->getShapes((PxShape**)&shapes.front(), (PxU32)shapes.size());
-		if (index == -1)
-			return shapes;
-		else if (index < shapes.size())
-		{
-			return std::vector<PxShape*>(1, shapes[index]);
-		}
-		else
-			return std::vector<PxShape*>();
+		return shapes;
 	}
 
 	void Actor::SetTrigger(bool value, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
+		PxU32 first, last;
+		ShapeRange(shape_index, first, last);
+		for (PxU32 i = first; i < last; i++)
 		{
-			shape_list[i]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !value);
-			shape_list[i]->setFlag(PxShapeFlag::eTRIGGER_SHAPE, value);
+			shapes[i]->setFlag(PxShapeFlag::eSIMULATION_SHAPE, !value);
+			shapes[i]->setFlag(PxShapeFlag::eTRIGGER_SHAPE, value);
 		}
 	}
 
 	void Actor::SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index)
 	{
-		std::vector<PxShape*> shape_list = GetShapes(shape_index);
-		for (PxU32 i = 0; i < shape_list.size(); i++)
-			shape_list[i]->setSimulationFilterData(PxFilterData(filterGroup, filterMask, 0, 0));
+		PxU32 first, last;
+		ShapeRange(shape_index, first, last);
+		for (PxU32 i = first; i < last; i++)
+			shapes[i]->setSimulationFilterData(PxFilterData(filterGroup, filterMask, 0, 0));
 
 		// PxFilterData(word0, word1, 0, 0)
 		// word0 = own ID
@@ -209,7 +377,7 @@ namespace PhysicsEngine
 		return name;
 	}
 
-	DynamicActor::DynamicActor(const PxTransform& pose) : Actor()
+	DynamicActor::DynamicActor(const PxTransform& pose) : Actor(), mass_dirty(false), mass_density(1.f)
 	{
 		actor = (PxActor*)GetPhysics()->createRigidDynamic(pose);
 		Name("");
@@ -217,19 +385,27 @@ namespace PhysicsEngine
 
 	DynamicActor::~DynamicActor()
 	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
+		if (!actor)
+			return;
+		for (unsigned int i = 0; i < shapes.size(); i++)
+			delete (UserData*)shapes[i]->userData;
 	}
 
 	void DynamicActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
-		PxShape* shape = ((PxRigidDynamic*)actor)->createShape(geometry, *GetMaterial());
-		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, density);
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		AddShape(((PxRigidDynamic*)actor)->createShape(geometry, *GetMaterial()));
+		//the last density applies to all shapes
+		mass_density = density;
+		mass_dirty = true;
+	}
+
+	void DynamicActor::UpdateMass()
+	{
+		if (!mass_dirty || !actor)
+			return;
+
+		PxRigidBodyExt::updateMassAndInertia(*(PxRigidDynamic*)actor, mass_density);
+		mass_dirty = false;
 	}
 
 	void DynamicActor::SetKinematic(bool value, PxU32 index)
@@ -249,18 +425,35 @@ namespace PhysicsEngine
 
 	StaticActor::~StaticActor()
 	{
-		for (unsigned int i = 0; i < colors.size(); i++)
-			delete (UserData*)GetShape(i)->userData;
+		if (!actor)
+			return;
+		for (unsigned int i = 0; i < shapes.size(); i++)
+			delete (UserData*)shapes[i]->userData;
 	}
 
 	void StaticActor::CreateShape(const PxGeometry& geometry, PxReal density)
 	{
-		PxShape* shape = ((PxRigidStatic*)actor)->createShape(geometry, *GetMaterial());
-		colors.push_back(default_color);
-		//pass the color pointers to the renderer
-		shape->userData = new UserData();
-		for (unsigned int i = 0; i < colors.size(); i++)
-			((UserData*)GetShape(i)->userData)->color = &colors[i];
+		AddShape(((PxRigidStatic*)actor)->createShape(geometry, *GetMaterial()));
+	}
+
+	///Joint methods
+
+	std::map<PxU64, Joint*>& Joint::Registry()
+	{
+		static std::map<PxU64, Joint*> registry;
+		return registry;
+	}
+
+	PxU64 Joint::Register(Joint* wrapper)
+	{
+		Registry()[++next_joint_key] = wrapper;
+		return next_joint_key;
+	}
+
+	Joint::~Joint()
+	{
+		Registry().erase(registry_key);
+		claimed_joints.erase(registry_key);
 	}
 
 	///Scene methods
@@ -270,25 +463,34 @@ namespace PhysicsEngine
 		PxSceneDesc sceneDesc(GetPhysics()->getTolerancesScale());
 
 		if (!sceneDesc.cpuDispatcher)
-		{
-			PxDefaultCpuDispatcher* mCpuDispatcher = PxDefaultCpuDispatcherCreate(1);
-			sceneDesc.cpuDispatcher = mCpuDispatcher;
-		}
+			sceneDesc.cpuDispatcher = AcquireDispatcher(config);
 
 		sceneDesc.filterShader = filter_shader;
 
 		px_scene = GetPhysics()->createScene(sceneDesc);
 
 		if (!px_scene)
+		{
+			ReleaseDispatcher();
 			throw new Exception("PhysicsEngine::Scene::Init, Could not initialise the scene.");
+		}
 
 		//default gravity
 		px_scene->setGravity(PxVec3(0.0f, -9.81f, 0.0f));
 
 		CustomInit();
+		ClaimJoints();
+
+		//keep the initial state for fast resets
+		if (config.snapshot)
+			Snapshot();
 
 		pause = false;
 
+		accumulator = 0.f;
+		prev_poses.clear();
+		step_count = 0;
+
 		selected_actor = 0;
 
 		SelectNextActor();
@@ -296,28 +498,161 @@ namespace PhysicsEngine
 
 	void Scene::Update(PxReal dt)
 	{
+		PROFILE_ZONE("Scene::Update");
+
+		//finish the previous step first (pipelined mode)
+		Sync();
+
 		if (pause)
 			return;
 
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		{
+			PROFILE_ZONE("PxScene::simulate");
+			px_scene->simulate(dt);
+		}
+		simulate_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+		simulating = true;
+		simulating_dt = dt;
+
+		if (!pipelined)
+			Sync();
+	}
+
+	void Scene::Pipelined(bool value)
+	{
+		if (!value)
+			Sync();
+		pipelined = value;
+	}
+
+	void Scene::Sync()
+	{
+		if (!simulating)
+			return;
+
+		PROFILE_ZONE("Scene::Sync");
+
+		//the previous poses are still readable until the results are fetched
+		if (pipelined || store_poses)
+			StorePoses();
+
+		std::chrono::high_resolution_clock::time_point start = std::chrono::high_resolution_clock::now();
+		{
+			PROFILE_ZONE("PxScene::fetchResults");
+			px_scene->fetchResults(true);
+		}
+		fetch_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+
+		simulating = false;
+		step_count++;
+
+		start = std::chrono::high_resolution_clock::now();
+		CustomUpdate(simulating_dt);
+		update_time += std::chrono::duration<double>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	void Scene::FixedStep(PxReal step, PxU32 substeps)
+	{
+		fixed_step = step;
+		max_substeps = substeps;
+	}
+
+	PxU32 Scene::Advance(PxReal wall_dt)
+	{
+		if (pause)
+			return 0;
 
-		px_scene->simulate(dt);
-		px_scene->fetchResults(true);
-		CustomUpdate(dt);
+		PROFILE_ZONE("Scene::Advance");
+
+		accumulator += wall_dt;
+
+		PxU32 steps = (PxU32)(accumulator / fixed_step);
+		if (steps > max_substeps)
+		{
+			//the simulation cannot keep up, drop the excess time instead of spiralling
+			steps = max_substeps;
+			accumulator = fmodf(accumulator, fixed_step) + steps * fixed_step;
+		}
+
+		for (PxU32 i = 0; i < steps; i++)
+		{
+			store_poses = (i == steps - 1);
+			Update(fixed_step);
+			accumulator -= fixed_step;
+		}
+		store_poses = false;
+
+		return steps;
+	}
+
+	PxReal Scene::Alpha()
+	{
+		return PxClamp(accumulator / fixed_step, 0.f, 1.f);
+	}
+
+	void Scene::StorePoses()
+	{
+		prev_poses.clear();
+
+#if PX_PHYSICS_VERSION < 0x304000 // SDK 3.3
+		std::vector<PxActor*> actors(px_scene->getNbActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC));
+		if (actors.size())
+			px_scene->getActors(PxActorTypeSelectionFlag::eRIGID_DYNAMIC, &actors.front(), (PxU32)actors.size());
+#else
+		std::vector<PxActor*> actors(px_scene->getNbActors(PxActorTypeFlag::eRIGID_DYNAMIC));
+		if (actors.size())
+			px_scene->getActors(PxActorTypeFlag::eRIGID_DYNAMIC, &actors.front(), (PxU32)actors.size());
+#endif
+
+		for (PxU32 i = 0; i < actors.size(); i++)
+			prev_poses[actors[i]] = ((PxRigidActor*)actors[i])->getGlobalPose();
+	}
+
+	PxTransform Scene::InterpolatedPose(PxActor* actor)
+	{
+		PxTransform pose = ((PxRigidActor*)actor)->getGlobalPose();
+
+		//actors added after the last step have no previous pose
+		std::unordered_map<PxActor*, PxTransform>::const_iterator prev = prev_poses.find(actor);
+		if (prev == prev_poses.end())
+			return pose;
+
+		PxReal alpha = Alpha();
+		PxQuat q0 = prev->second.q;
+		//take the shortest arc
+		if (q0.dot(pose.q) < 0.f)
+			q0 = -q0;
+
+		return PxTransform(prev->second.p + (pose.p - prev->second.p) * alpha,
+			(q0 * (1.f - alpha) + pose.q * alpha).getNormalized());
 	}
 
 	void Scene::Remove(Actor* actor)
 	{
 		if (!actor->Get()) return;
+		//removed actors cannot stay selected (they may be released or recycled)
+		if (actor->Get() == selected_actor)
+		{
+			HighlightOff(selected_actor);
+			selected_actor = 0;
+		}
 		px_scene->removeActor(*actor->Get());
+		prev_poses.erase(actor->Get());
 	}
 
 	void Scene::Add(PxRigidDynamic* actor)
 	{
+		//the event callback is told when the actor falls asleep or wakes up
+		actor->setActorFlag(PxActorFlag::eSEND_SLEEP_NOTIFIES, true);
 		px_scene->addActor(*actor);
 	}
 
 	void Scene::Add(Actor* actor)
 	{
+		added_actors.insert(actor->RegistryKey());
+		actor->UpdateMass();
+		actor->Get()->setActorFlag(PxActorFlag::eSEND_SLEEP_NOTIFIES, true);
 		px_scene->addActor(*actor->Get());
 	}
 
@@ -328,12 +663,12 @@ namespace PhysicsEngine
 		case (Entity::ETree): {
 			for (DynamicTreePart* part : ((Tree*)person)->getTrunkParts())
 			{
-				if (part) px_scene->addActor(*part->Get());
+				if (part) Add(part);
 			}
 
 			for (RC_Cylinder* part : ((Tree*)person)->getParts())
 			{
-				if (part) px_scene->addActor(*part->Get());
+				if (part) Add(part);
 			}
 			break;
 		}
@@ -345,12 +680,314 @@ namespace PhysicsEngine
 		return px_scene;
 	}
 
+	Scene::~Scene()
+	{
+		if (px_scene)
+		{
+			if (simulating)
+				px_scene->fetchResults(true);
+
+			//the wrappers of this scene go first (they read the shapes), so none is left pointing at a released object
+			std::vector<PxActor*> stale_actors;
+			std::vector<PxJoint*> stale_joints;
+			DeleteWrappers(0, 0, stale_actors, stale_joints);
+
+			PxCollection* live = CollectLiveObjects(stale_actors, stale_joints);
+			PxCollectionExt::releaseObjects(*live);
+			live->release();
+
+			//objects restored from the snapshot lived in our memory block
+			if (restored_memory)
+				free(restored_memory);
+			restored_memory = 0;
+			ReleaseSnapshot();
+
+			px_scene->release();
+			ReleaseDispatcher();
+		}
+	}
+
 	void Scene::Reset()
 	{
+		Sync();
+
+		if (Restore())
+			return;
+
+		//no snapshot: delete the wrappers of this scene, release their objects and recreate the scene
+		std::vector<PxActor*> stale_actors;
+		std::vector<PxJoint*> stale_joints;
+		DeleteWrappers(0, 0, stale_actors, stale_joints);
+
+		PxCollection* live = CollectLiveObjects(stale_actors, stale_joints);
+		PxCollectionExt::releaseObjects(*live);
+		live->release();
+
+		if (restored_memory)
+			free(restored_memory);
+		restored_memory = 0;
+		ReleaseSnapshot();
+
 		px_scene->release();
+		px_scene = 0;
+		ReleaseDispatcher();
 		Init();
 	}
 
+	void Scene::AddJoints(PxCollection& collection)
+	{
+		std::vector<PxConstraint*> constraints(px_scene->getNbConstraints());
+		if (constraints.size())
+			px_scene->getConstraints(&constraints.front(), (PxU32)constraints.size());
+
+		for (PxU32 i = 0; i < constraints.size(); i++)
+		{
+			PxU32 type;
+			void* reference = constraints[i]->getExternalReference(type);
+			if ((type == PxConstraintExtIDs::eJOINT) && reference && !collection.contains(*(PxJoint*)reference))
+				collection.add(*(PxJoint*)reference);
+		}
+	}
+
+	PxCollection* Scene::CollectLiveObjects(const std::vector<PxActor*>& stale_actors, const std::vector<PxJoint*>& stale_joints)
+	{
+		PxCollection* live = PxCollectionExt::createCollection(*px_scene);
+		AddJoints(*live);
+
+		//actors and joints of the snapshot that were taken out of the scene since (e.g. the broken house)
+		for (PxU32 i = 0; i < snapshot_actors.size(); i++)
+		{
+			if (!Actor::Registry().count(snapshot_actors[i].key))
+				continue;
+			PxActor* a = snapshot_actors[i].wrapper->Get();
+			if (a && !a->getScene() && !live->contains(*a))
+				live->add(*a);
+		}
+		for (PxU32 i = 0; i < snapshot_joints.size(); i++)
+		{
+			if (!Joint::Registry().count(snapshot_joints[i].key))
+				continue;
+			PxJoint* j = snapshot_joints[i].wrapper->Get();
+			if (j && !live->contains(*j))
+				live->add(*j);
+		}
+
+		for (PxU32 i = 0; i < stale_actors.size(); i++)
+			if (!live->contains(*stale_actors[i]))
+				live->add(*stale_actors[i]);
+		for (PxU32 i = 0; i < stale_joints.size(); i++)
+			if (!live->contains(*stale_joints[i]))
+				live->add(*stale_joints[i]);
+
+		return live;
+	}
+
+	void Scene::ClaimJoints()
+	{
+		std::set<PxActor*> actors;
+		for (std::set<PxU64>::iterator it = added_actors.begin(); it != added_actors.end(); it++)
+		{
+			std::map<PxU64, Actor*>::iterator wrapper = Actor::Registry().find(*it);
+			if ((wrapper != Actor::Registry().end()) && wrapper->second->Get())
+				actors.insert(wrapper->second->Get());
+		}
+
+		//the joints claimed by other scenes are not touched, those scenes delete them before their objects go
+		for (std::map<PxU64, Joint*>::iterator it = Joint::Registry().begin(); it != Joint::Registry().end(); it++)
+		{
+			PxJoint* j = it->second->Get();
+			if (!j || claimed_joints.count(it->first))
+				continue;
+			PxRigidActor* actor0 = 0;
+			PxRigidActor* actor1 = 0;
+			j->getActors(actor0, actor1);
+			if ((j->getScene() == px_scene) || actors.count(actor0) || actors.count(actor1))
+			{
+				added_joints.insert(it->first);
+				claimed_joints.insert(it->first);
+			}
+		}
+	}
+
+	void Scene::DeleteWrappers(PxU64 actor_key, PxU64 joint_key, std::vector<PxActor*>& stale_actors, std::vector<PxJoint*>& stale_joints)
+	{
+		//the joints are matched to the actors while their wrappers still exist
+		ClaimJoints();
+
+		//owners first, the wrappers they own are gone from the registry when they are reached
+		std::vector<PxU64> keys(added_actors.upper_bound(actor_key), added_actors.end());
+		added_actors.erase(added_actors.upper_bound(actor_key), added_actors.end());
+		for (PxU32 i = 0; i < keys.size(); i++)
+		{
+			std::map<PxU64, Actor*>::iterator it = Actor::Registry().find(keys[i]);
+			//already deleted by its owner
+			if (it == Actor::Registry().end())
+				continue;
+			if (it->second->Get())
+				stale_actors.push_back(it->second->Get());
+			delete it->second;
+		}
+
+		//only the joints of this scene, a joint to a deleted actor was created after it
+		keys.assign(added_joints.upper_bound(joint_key), added_joints.end());
+		added_joints.erase(added_joints.upper_bound(joint_key), added_joints.end());
+		for (PxU32 i = 0; i < keys.size(); i++)
+		{
+			std::map<PxU64, Joint*>::iterator it = Joint::Registry().find(keys[i]);
+			if (it == Joint::Registry().end())
+				continue;
+			if (it->second->Get())
+				stale_joints.push_back(it->second->Get());
+			delete it->second;
+		}
+	}
+
+	void Scene::ReleaseSnapshot()
+	{
+		if (shared_collection)
+			shared_collection->release();
+		if (serial_registry)
+			serial_registry->release();
+		shared_collection = 0;
+		serial_registry = 0;
+
+		snapshot.clear();
+		snapshot_actors.clear();
+		snapshot_joints.clear();
+	}
+
+	bool Scene::Snapshot()
+	{
+		Sync();
+		ReleaseSnapshot();
+
+		serial_registry = PxSerialization::createSerializationRegistry(*GetPhysics());
+
+		//materials, meshes and fabrics stay alive and are referenced by id
+		shared_collection = PxCollectionExt::createCollection(*GetPhysics());
+		PxSerialization::createSerialObjectIds(*shared_collection, PxSerialObjectId(1));
+
+		PxCollection* collection = PxCollectionExt::createCollection(*px_scene);
+		AddJoints(*collection);
+		PxSerialization::complete(*collection, *serial_registry, shared_collection);
+		PxSerialization::createSerialObjectIds(*collection, PxSerialObjectId(shared_collection->getNbObjects() + 1));
+
+		bool ok = PxSerialization::isSerializable(*collection, *serial_registry, shared_collection);
+		if (ok)
+		{
+			PxDefaultMemoryOutputStream stream;
+			ok = PxSerialization::serializeCollectionToBinary(stream, *collection, *serial_registry, shared_collection, true);
+			if (ok)
+				snapshot.assign(stream.getData(), stream.getData() + stream.getSize());
+		}
+
+		if (ok)
+		{
+			//wrapper metadata: which object each wrapper owns and its colours
+			for (std::map<PxU64, Actor*>::iterator it = Actor::Registry().begin(); it != Actor::Registry().end(); it++)
+			{
+				PxActor* a = it->second->Get();
+				if (!a || !collection->contains(*a))
+					continue;
+
+				ActorState state = { it->first, it->second, collection->getId(*a) };
+				for (PxU32 i = 0; it->second->Color(i); i++)
+					state.colors.push_back(*it->second->Color(i));
+				snapshot_actors.push_back(state);
+			}
+
+			for (std::map<PxU64, Joint*>::iterator it = Joint::Registry().begin(); it != Joint::Registry().end(); it++)
+			{
+				PxJoint* j = it->second->Get();
+				if (j && collection->contains(*j))
+				{
+					JointState state = { it->first, it->second, collection->getId(*j) };
+					snapshot_joints.push_back(state);
+				}
+			}
+
+			snapshot_actor_key = next_actor_key;
+			snapshot_joint_key = next_joint_key;
+		}
+		else
+			cerr << "PhysicsEngine::Scene::Snapshot, the scene is not serializable, resets will re-initialise it." << endl;
+
+		collection->release();
+
+		if (!ok)
+			ReleaseSnapshot();
+		return ok;
+	}
+
+	bool Scene::Restore()
+	{
+		if (snapshot.empty())
+			return false;
+
+		Sync();
+
+		//delete wrappers created after the snapshot (debris, particles, ...)
+		std::vector<PxActor*> stale_actors;
+		std::vector<PxJoint*> stale_joints;
+		DeleteWrappers(snapshot_actor_key, snapshot_joint_key, stale_actors, stale_joints);
+
+		//everything currently simulated is released once the wrappers point at the restored copies
+		PxCollection* live = CollectLiveObjects(stale_actors, stale_joints);
+
+		//binary collections are deserialised in place from a 128-byte aligned block
+		void* memory = malloc(snapshot.size() + PX_SERIAL_FILE_ALIGN);
+		void* block = (void*)(((size_t)memory + PX_SERIAL_FILE_ALIGN - 1) & ~(size_t)(PX_SERIAL_FILE_ALIGN - 1));
+		memcpy(block, &snapshot.front(), snapshot.size());
+
+		PxCollection* collection = PxSerialization::createCollectionFromBinary(block, *serial_registry, shared_collection);
+		if (!collection)
+		{
+			free(memory);
+			live->release();
+			return false;
+		}
+
+		for (PxU32 i = 0; i < snapshot_actors.size(); i++)
+		{
+			ActorState& state = snapshot_actors[i];
+			if (!Actor::Registry().count(state.key))
+				continue;
+
+			state.wrapper->Rebind(static_cast<PxActor*>(collection->find(state.id)));
+			for (PxU32 j = 0; j < state.colors.size(); j++)
+				state.wrapper->Color(state.colors[j], j);
+		}
+
+		for (PxU32 i = 0; i < snapshot_joints.size(); i++)
+		{
+			JointState& state = snapshot_joints[i];
+			if (Joint::Registry().count(state.key))
+				state.wrapper->Rebind(static_cast<PxJoint*>(collection->find(state.id)));
+		}
+
+		PxCollectionExt::releaseObjects(*live);
+		live->release();
+
+		px_scene->addCollection(*collection);
+		collection->release();
+
+		//the previous restored objects have been released
+		if (restored_memory)
+			free(restored_memory);
+		restored_memory = memory;
+
+		accumulator = 0.f;
+		prev_poses.clear();
+		step_count = 0;
+		selected_actor = 0;
+
+		CustomRestore();
+
+		SelectNextActor();
+
+		return true;
+	}
+
 	void Scene::Pause(bool value)
 	{
 		pause = value;
@@ -1,10 +1,16 @@
 #pragma once
 
 #include <vector>
+#include <deque>
 #include "PxPhysicsAPI.h"
 #include "Exception.h"
-#include "Extras\UserData.h"
+#include "Extras/UserData.h"
+#include "MeshPack.h"
+#include "Profiler.h"
 #include <string>
+#include <unordered_map>
+#include <map>
+#include <set>
 #include "extensions/PxExtensionsAPI.h"
 
 namespace PhysicsEngine
@@ -30,8 +36,37 @@ namespace PhysicsEngine
 	///Create a new material
 	PxMaterial* CreateMaterial(PxReal sf=.0f, PxReal df=.0f, PxReal cr=.0f);
 
+	///Scene creation options
+	struct SceneConfig
+	{
+		//number of PhysX worker threads (0 - auto-detect from the hardware)
+		PxU32 threads;
+		//core affinity mask, worker i is pinned to the i-th set bit (0 - no affinity)
+		PxU32 affinity_mask;
+		//serialise the scene after CustomInit so that Reset restores it in place (costs a full serialisation per Init),
+		//without it Reset re-initialises the scene
+		bool snapshot;
+
+		SceneConfig(PxU32 _threads=0, PxU32 _affinity_mask=0, bool _snapshot=false)
+			: threads(_threads), affinity_mask(_affinity_mask), snapshot(_snapshot)
+		{
+		}
+	};
+
+	///Number of worker threads the dispatcher will use for the given config
+	PxU32 WorkerThreads(const SceneConfig& config);
+
+	///Get the CPU dispatcher shared by all scenes (created on first use), a scene asking for another config
+	///while it is in use gets the existing one with a warning
+	PxDefaultCpuDispatcher* AcquireDispatcher(const SceneConfig& config);
+
+	///Drop a scene reference to the shared CPU dispatcher
+	void ReleaseDispatcher();
+
 	static const PxVec3 default_color(.8f,.8f,.8f);
 
+	class Joint;
+
 	enum Entity {
 		ETree,
 		ECharacter
@@ -44,34 +79,66 @@ namespace PhysicsEngine
 	{
 	protected:
 		PxActor* actor;
-		std::vector<PxVec3> colors;
+		//shapes in creation order, kept in sync with the actor (no per-call copies)
+		std::vector<PxShape*> shapes;
+		//a deque keeps the colour addresses (referenced by the shape user data) stable while growing
+		std::deque<PxVec3> colors;
 		std::string name;
+		//position in the wrapper registry (creation order)
+		PxU64 registry_key;
+
+		static PxU64 Register(Actor* wrapper);
+
+		//clamp the shape index (-1 - all shapes) to a [first, last) range
+		void ShapeRange(PxU32 shape_index, PxU32& first, PxU32& last);
+
+		//register a shape created on the actor with the given colour
+		void AddShape(PxShape* shape);
 
 	public:
 		///Constructor
 		Actor()
-			: actor(0)
+			: actor(0), registry_key(Register(this))
 		{
 		}
 
+		virtual ~Actor();
+
+		///All actor wrappers alive, in creation order
+		static std::map<PxU64, Actor*>& Registry();
+
+		///Position in the wrapper registry
+		PxU64 RegistryKey() { return registry_key; }
+
 		PxActor* Get();
 
+		///Point the wrapper at an equivalent PxActor (e.g. restored from a snapshot),
+		///the actor and shape user data (colours) are moved across
+		virtual void Rebind(PxActor* new_actor);
+
 		void Color(PxVec3 new_color, PxU32 shape_index=-1);
 
 		const PxVec3* Color(PxU32 shape_indx=0);
 
-		void Actor::Name(const string& name);
+		void Name(const string& name);
 
-		string Actor::Name();
+		string Name();
 
 		void Material(PxMaterial* new_material, PxU32 shape_index=-1);
 
 		PxShape* GetShape(PxU32 index=0);
 
-		std::vector<PxShape*> Actor::GetShapes(PxU32 index=-1);
+		const std::vector<PxShape*>& GetShapes();
 
 		virtual void CreateShape(const PxGeometry& geometry, PxReal density) {}
 
+		///Detach and release the shape (the remaining shapes move down by one)
+		void RemoveShape(PxU32 index);
+
+		///Compute the mass and inertia for the shapes created so far (done when the actor is added to a scene),
+		///the shapes are at their final local poses, unlike after each CreateShape where the last shape was not posed yet
+		virtual void UpdateMass() {}
+
 		void SetTrigger(bool value, PxU32 index=-1);
 
 		void SetupFiltering(PxU32 filterGroup, PxU32 filterMask, PxU32 shape_index=-1);
@@ -79,6 +146,11 @@ namespace PhysicsEngine
 
 	class DynamicActor : public Actor
 	{
+	protected:
+		//the mass is computed once for all shapes instead of after every CreateShape
+		bool mass_dirty;
+		PxReal mass_density;
+
 	public:
 		DynamicActor(const PxTransform& pose);
 
@@ -86,6 +158,8 @@ namespace PhysicsEngine
 
 		void CreateShape(const PxGeometry& geometry, PxReal density);
 
+		void UpdateMass();
+
 		void SetKinematic(bool value, PxU32 index=-1);
 	};
 
@@ -111,15 +185,85 @@ namespace PhysicsEngine
 		PxRigidDynamic* selected_actor;
 		//original and modified colour of the selected actor
 		std::vector<PxVec3> sactor_color_orig;
+		//binary snapshot of the scene taken after CustomInit
+		struct ActorState
+		{
+			PxU64 key;
+			Actor* wrapper;
+			PxSerialObjectId id;
+			std::vector<PxVec3> colors;
+		};
+		struct JointState
+		{
+			PxU64 key;
+			Joint* wrapper;
+			PxSerialObjectId id;
+		};
+		PxSerializationRegistry* serial_registry;
+		//materials and meshes referenced (not copied) by the snapshot
+		PxCollection* shared_collection;
+		std::vector<PxU8> snapshot;
+		std::vector<ActorState> snapshot_actors;
+		std::vector<JointState> snapshot_joints;
+		//wrappers created after these keys are not part of the snapshot
+		PxU64 snapshot_actor_key, snapshot_joint_key;
+		//memory holding the objects restored from the snapshot (must outlive them)
+		void* restored_memory;
+		//registry keys of the wrappers added to this scene (removed ones included)
+		std::set<PxU64> added_actors;
+		//registry keys of the joint wrappers between the actors of this scene
+		std::set<PxU64> added_joints;
 		//custom filter shader
 		PxSimulationFilterShader filter_shader;
+		//dispatcher options
+		SceneConfig config;
+		//fixed step size and the maximum number of sub-steps per Advance call
+		PxReal fixed_step;
+		PxU32 max_substeps;
+		//wall-clock time not simulated yet
+		PxReal accumulator;
+		//poses of dynamic actors before the last sub-step (for render interpolation)
+		std::unordered_map<PxActor*, PxTransform> prev_poses;
+		bool store_poses;
+		//pipelined mode: a step is left running after Update and fetched by the next Sync
+		bool pipelined;
+		bool simulating;
+		PxReal simulating_dt;
+		//total time spent starting steps, blocked in fetchResults and in CustomUpdate (in seconds)
+		double simulate_time;
+		double fetch_time;
+		double update_time;
+		//number of steps completed since Init/Reset
+		PxU32 step_count;
+
+		void StorePoses();
+
+		void AddJoints(PxCollection& collection);
+
+		//everything simulated by the scene plus the given objects that were taken out of it
+		PxCollection* CollectLiveObjects(const std::vector<PxActor*>& stale_actors, const std::vector<PxJoint*>& stale_joints);
+
+		void ReleaseSnapshot();
+
+		//take over the joint wrappers created since the last call whose actors belong to this scene
+		void ClaimJoints();
+
+		//delete the wrappers added to this scene after the given registry keys and the joints between their actors,
+		//their PhysX objects are returned for release
+		void DeleteWrappers(PxU64 actor_key, PxU64 joint_key, std::vector<PxActor*>& stale_actors, std::vector<PxJoint*>& stale_joints);
 
 		void HighlightOn(PxRigidDynamic* actor);
 
 		void HighlightOff(PxRigidDynamic* actor);
 
 	public:
-		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader) : filter_shader(custom_filter_shader) {}
+		Scene(PxSimulationFilterShader custom_filter_shader=PxDefaultSimulationFilterShader, const SceneConfig& scene_config=SceneConfig())
+			: px_scene(0), serial_registry(0), shared_collection(0), snapshot_actor_key(0), snapshot_joint_key(0), restored_memory(0),
+			filter_shader(custom_filter_shader), config(scene_config),
+			fixed_step(1.f/90.f), max_substeps(5), accumulator(0.f), store_poses(false),
+			pipelined(false), simulating(false), simulating_dt(0.f), simulate_time(0.), fetch_time(0.), update_time(0.), step_count(0) {}
+
+		virtual ~Scene();
 
 		///Init the scene
 		void Init();
@@ -130,9 +274,45 @@ namespace PhysicsEngine
 		///Perform a single simulation step
 		void Update(PxReal dt);
 
+		///Enable the pipelined mode, the step started by Update keeps running until the next Sync
+		void Pipelined(bool value);
+
+		///Get the pipelined mode
+		bool Pipelined() { return pipelined; }
+
+		///Wait for the step in flight (if any) and run the user defined update for it
+		void Sync();
+
+		///Total time spent starting simulation steps (in seconds)
+		double SimulateTime() { return simulate_time; }
+
+		///Total time spent waiting for simulation results (in seconds)
+		double FetchTime() { return fetch_time; }
+
+		///Total time spent in the user defined update (in seconds)
+		double UpdateTime() { return update_time; }
+
+		///Number of steps completed since Init/Reset
+		PxU32 Step() { return step_count; }
+
 		///User defined update step
 		virtual void CustomUpdate(float dt) {}
 
+		///Set the fixed step size and the maximum number of sub-steps used by Advance
+		void FixedStep(PxReal step, PxU32 substeps=5);
+
+		///Get the fixed step size
+		PxReal FixedStep() { return fixed_step; }
+
+		///Accumulate wall-clock time and run 0..max_substeps fixed steps, returns the number of steps taken
+		PxU32 Advance(PxReal wall_dt);
+
+		///Interpolation factor between the previous and the current step [0..1)
+		PxReal Alpha();
+
+		///Pose of the actor blended between the previous and the current step
+		PxTransform InterpolatedPose(PxActor* actor);
+
 		///Add actors
 		void Remove(Actor* actor);
 		void Add(PxRigidDynamic* actor);
@@ -142,9 +322,18 @@ namespace PhysicsEngine
 		///Get the PxScene object
 		PxScene* Get();
 
-		///Reset the scene
+		///Reset the scene (restores the snapshot if there is one, see SceneConfig::snapshot)
 		void Reset();
 
+		///Capture the state of all actors, shapes, joints and wrapper colours in memory
+		bool Snapshot();
+
+		///Restore the snapshot in place, wrappers created after the snapshot are deleted
+		bool Restore();
+
+		///User defined restore step, drop the references to wrappers created after the snapshot here
+		virtual void CustomRestore() {}
+
 		///Set pause
 		void Pause(bool value);
 
@@ -159,6 +348,9 @@ namespace PhysicsEngine
 
 		///a list with all actors
 		std::vector<PxActor*> GetAllActors();
+
+		///Get the dispatcher options
+		const SceneConfig& Config() { return config; }
 	};
 
 	///Generic Joint class
@@ -166,11 +358,23 @@ namespace PhysicsEngine
 	{
 	protected:
 		PxJoint* joint;
+		//position in the wrapper registry (creation order)
+		PxU64 registry_key;
+
+		static PxU64 Register(Joint* wrapper);
 
 	public:
-		Joint() : joint(0) {}
+		Joint() : joint(0), registry_key(Register(this)) {}
+
+		virtual ~Joint();
+
+		///All joint wrappers alive, in creation order
+		static std::map<PxU64, Joint*>& Registry();
 
 		PxJoint* Get() { return joint; }
+
+		///Point the wrapper at an equivalent PxJoint (e.g. restored from a snapshot)
+		void Rebind(PxJoint* new_joint) { joint = new_joint; }
 	};
 
 
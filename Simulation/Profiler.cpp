@@ -0,0 +1,269 @@
+#include "Profiler.h"
+
+#ifdef PROFILER
+#include "PxPhysicsAPI.h"
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <vector>
+#endif
+
+namespace Profiler
+{
+#ifdef PROFILER
+	using namespace std;
+
+	enum EventType : unsigned char
+	{
+		BEGIN,
+		END,
+		//PhysX zones that can end on another thread
+		ASYNC_BEGIN,
+		ASYNC_END
+	};
+
+	struct Event
+	{
+		const char* name;
+		//nanoseconds since Start
+		long long time;
+		//context of an async zone
+		unsigned long long id;
+		EventType type;
+		bool physx;
+	};
+
+	//events of a single thread, written by that thread only
+	struct ThreadBuffer
+	{
+		vector<Event> events;
+		//events written since Start, the last events.size() of them are kept
+		atomic<unsigned long long> count;
+		string name;
+		unsigned int id;
+	};
+
+	//events kept per thread
+	static const size_t buffer_size = 1 << 17;
+
+	static atomic<bool> running(false);
+	static chrono::steady_clock::time_point epoch;
+	//buffers of all threads that have recorded an event (registered once per thread, never freed)
+	static vector<unique_ptr<ThreadBuffer> > buffers;
+	static mutex buffers_mutex;
+	static thread_local ThreadBuffer* thread_buffer = 0;
+
+	static ThreadBuffer* CurrentBuffer()
+	{
+		if (!thread_buffer)
+		{
+			unique_ptr<ThreadBuffer> buffer(new ThreadBuffer());
+			buffer->events.resize(buffer_size);
+			buffer->count = 0;
+			lock_guard<mutex> lock(buffers_mutex);
+			buffer->id = (unsigned int)buffers.size() + 1;
+			buffer->name = "thread " + to_string(buffer->id);
+			thread_buffer = buffer.get();
+			buffers.push_back(move(buffer));
+		}
+		return thread_buffer;
+	}
+
+	static void Record(const char* name, EventType type, unsigned long long id=0, bool physx=false)
+	{
+		ThreadBuffer* buffer = CurrentBuffer();
+		unsigned long long count = buffer->count.load(memory_order_relaxed);
+		Event& event = buffer->events[count % buffer_size];
+		event.name = name;
+		event.time = chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+		event.id = id;
+		event.type = type;
+		event.physx = physx;
+		//publish the event to the trace writer
+		buffer->count.store(count + 1, memory_order_release);
+	}
+
+#if PX_PHYSICS_VERSION >= 0x304000 // SDK 3.4
+	//records the PhysX zones and forwards them to the callback registered before (e.g. the PVD connection)
+	class PhysXCallback : public physx::PxProfilerCallback
+	{
+	public:
+		physx::PxProfilerCallback* previous;
+
+		PhysXCallback() : previous(0) {}
+
+		virtual void* zoneStart(const char* eventName, bool detached, uint64_t contextId)
+		{
+			if (running.load(memory_order_relaxed))
+				Record(eventName, detached ? ASYNC_BEGIN : BEGIN, contextId, true);
+			return previous ? previous->zoneStart(eventName, detached, contextId) : 0;
+		}
+
+		virtual void zoneEnd(void* profilerData, const char* eventName, bool detached, uint64_t contextId)
+		{
+			if (running.load(memory_order_relaxed))
+				Record(eventName, detached ? ASYNC_END : END, contextId, true);
+			if (previous)
+				previous->zoneEnd(profilerData, eventName, detached, contextId);
+		}
+	};
+
+	static PhysXCallback physx_callback;
+	static bool hooked = false;
+#endif
+
+	bool Available()
+	{
+		return true;
+	}
+
+	void Start()
+	{
+		{
+			lock_guard<mutex> lock(buffers_mutex);
+			for (size_t i = 0; i < buffers.size(); i++)
+				buffers[i]->count.store(0);
+		}
+		epoch = chrono::steady_clock::now();
+		ThreadName("main");
+
+#if PX_PHYSICS_VERSION >= 0x304000 // SDK 3.4
+		if (!hooked)
+		{
+			physx_callback.previous = PxGetProfilerCallback();
+			PxSetProfilerCallback(&physx_callback);
+			hooked = true;
+		}
+#endif
+
+		running.store(true);
+	}
+
+	void Stop()
+	{
+		running.store(false);
+
+#if PX_PHYSICS_VERSION >= 0x304000 // SDK 3.4
+		if (hooked)
+		{
+			PxSetProfilerCallback(physx_callback.previous);
+			hooked = false;
+		}
+#endif
+	}
+
+	bool Running()
+	{
+		return running.load(memory_order_relaxed);
+	}
+
+	void ThreadName(const char* name)
+	{
+		ThreadBuffer* buffer = CurrentBuffer();
+		lock_guard<mutex> lock(buffers_mutex);
+		buffer->name = name;
+	}
+
+	void Begin(const char* name)
+	{
+		Record(name, BEGIN);
+	}
+
+	void End(const char* name)
+	{
+		Record(name, END);
+	}
+
+	static string Escape(const char* text)
+	{
+		string escaped;
+		for (; *text; text++)
+		{
+			if ((*text == '"') || (*text == '\\'))
+				escaped += '\\';
+			escaped += *text;
+		}
+		return escaped;
+	}
+
+	bool WriteChromeTrace(const string& filename)
+	{
+		ofstream file(filename.c_str());
+		if (!file)
+			return false;
+
+		file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[" << fixed << setprecision(3);
+
+		lock_guard<mutex> lock(buffers_mutex);
+		bool first = true;
+		for (size_t i = 0; i < buffers.size(); i++)
+		{
+			const ThreadBuffer& buffer = *buffers[i];
+			file << (first ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer.id
+				<< ",\"args\":{\"name\":\"" << Escape(buffer.name.c_str()) << "\"}}";
+			first = false;
+
+			unsigned long long count = buffer.count.load(memory_order_acquire);
+			unsigned long long start = (count > buffer_size) ? count - buffer_size : 0;
+			//the beginnings of the oldest zones may have been overwritten, their ends are skipped
+			int depth = 0;
+			for (unsigned long long j = start; j < count; j++)
+			{
+				const Event& event = buffer.events[j % buffer_size];
+				const char* phase = "B";
+				switch (event.type)
+				{
+				case BEGIN:
+					depth++;
+					break;
+				case END:
+					if (!depth)
+						continue;
+					depth--;
+					phase = "E";
+					break;
+				case ASYNC_BEGIN:
+					phase = "b";
+					break;
+				case ASYNC_END:
+					phase = "e";
+					break;
+				}
+
+				file << ",\n{\"name\":\"" << Escape(event.name) << "\",\"cat\":\"" << (event.physx ? "PhysX" : "Simulation")
+					<< "\",\"ph\":\"" << phase << "\",\"ts\":" << event.time / 1000. << ",\"pid\":1,\"tid\":" << buffer.id;
+				if ((event.type == ASYNC_BEGIN) || (event.type == ASYNC_END))
+					file << ",\"id\":" << event.id;
+				file << "}";
+			}
+		}
+
+		file << "\n]}\n";
+		return file.good();
+	}
+#else
+	bool Available()
+	{
+		return false;
+	}
+
+	void Start() {}
+
+	void Stop() {}
+
+	bool Running()
+	{
+		return false;
+	}
+
+	void ThreadName(const char* name) {}
+
+	bool WriteChromeTrace(const std::string& filename)
+	{
+		return false;
+	}
+#endif
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <string>
+
+///Scoped-zone profiler.
+
+///
+///Zones are recorded into a lock-free ring buffer of the calling thread (the last events of every thread are kept),
+///together with the PhysX profiler events (PxProfilerCallback, emitted by the checked and profile SDK builds),
+///and written as a Chrome trace (chrome://tracing or ui.perfetto.dev).
+///The zones are compiled in only when PROFILER is defined (e.g. /D PROFILER), otherwise PROFILE_ZONE is empty
+///and nothing is recorded.
+///
+
+#ifdef PROFILER
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+///Time the rest of the enclosing scope as a zone, the name must be a string literal
+#define PROFILE_ZONE(name) Profiler::Zone PROFILE_CONCAT(profile_zone_, __LINE__)(name)
+#else
+#define PROFILE_ZONE(name)
+#endif
+
+namespace Profiler
+{
+	///The zones are compiled in (PROFILER is defined)
+	bool Available();
+
+	///Drop the recorded events and start recording, the calling thread is named "main" in the trace
+	///(hooks the PhysX profiler events, call it after PxInit)
+	void Start();
+
+	///Stop recording and unhook the PhysX profiler events
+	void Stop();
+
+	///Is the profiler recording
+	bool Running();
+
+	///Name the calling thread in the trace
+	void ThreadName(const char* name);
+
+	///Write the recorded events as Chrome trace JSON, no simulation step may be running
+	bool WriteChromeTrace(const std::string& filename);
+
+#ifdef PROFILER
+	///Record the start and the end of a zone on the calling thread
+	void Begin(const char* name);
+	void End(const char* name);
+
+	///Records the lifetime of the object as a zone (see PROFILE_ZONE)
+	class Zone
+	{
+		const char* name;
+		//a zone started before Start is not ended either
+		bool recorded;
+
+	public:
+		Zone(const char* zone_name) : name(zone_name), recorded(Running())
+		{
+			if (recorded)
+				Begin(name);
+		}
+
+		~Zone()
+		{
+			if (recorded)
+				End(name);
+		}
+	};
+#endif
+}
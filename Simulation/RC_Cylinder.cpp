@@ -1,9 +1,18 @@
-#pragma once
 #include "RC_Cylinder.h"
+#include <limits>
+#include <map>
+#include <mutex>
+#include <tuple>
 
 namespace PhysicsEngine {
 
-	std::vector<PxVec3> GenerateCylinderVertices(float radius, float halfHeight, int slices)
+	//cooked cylinders by (radius, halfHeight, slices, taper), each entry holds one mesh reference,
+	//every shape created with the mesh adds its own so the mesh outlives the cache if still in use
+	typedef std::tuple<PxReal, PxReal, int, PxReal> CylinderKey;
+	std::map<CylinderKey, PxConvexMesh*> cylinder_cache;
+	std::mutex cylinder_cache_mutex;
+
+	std::vector<PxVec3> GenerateCylinderVertices(float radius, float halfHeight, int slices, float taper)
 	{
 		std::vector<PxVec3> verts;
 
@@ -13,15 +22,15 @@ namespace PhysicsEngine {
 			float z = radius * sin(angle);
 
 			verts.emplace_back(x, -halfHeight, z); // bottom
-			verts.emplace_back(x, halfHeight, z); // top
+			verts.emplace_back(x * taper, halfHeight, z * taper); // top
 		}
 		return verts;
 	}
 
 
-	PxConvexMesh* RC_Cylinder::CreateConvexCylinder(PxReal radius, PxReal halfHeight, int slices)
+	PxConvexMesh* RC_Cylinder::CreateConvexCylinder(PxReal radius, PxReal halfHeight, int slices, PxReal taper)
 	{
-		auto verts = GenerateCylinderVertices(radius, halfHeight, slices);
+		auto verts = GenerateCylinderVertices(radius, halfHeight, slices, taper);
 
 		PxConvexMeshDesc desc;
 			
@@ -35,47 +44,44 @@ namespace PhysicsEngine {
 		desc.points.data = verts.data();
 		desc.flags = PxConvexFlag::eCOMPUTE_CONVEX;
 
-		PxDefaultMemoryOutputStream buf;
-		bool ok = GetCooking()->cookConvexMesh(desc, buf);
-		if (!ok) return nullptr;
+		//cooked once per mesh pack
+		return CookConvexMesh(desc);
+	}
+
+	PxConvexMesh* RC_Cylinder::ConvexCylinder(PxReal radius, PxReal halfHeight, int slices, PxReal taper)
+	{
+		CylinderKey key(radius, halfHeight, slices, taper);
+
+		//cooking is done under the lock so that concurrent requests for the same cylinder cook it once
+		std::lock_guard<std::mutex> lock(cylinder_cache_mutex);
+
+		std::map<CylinderKey, PxConvexMesh*>::iterator it = cylinder_cache.find(key);
+		if (it != cylinder_cache.end())
+			return it->second;
+
+		PxConvexMesh* mesh = CreateConvexCylinder(radius, halfHeight, slices, taper);
+		if (mesh)
+			cylinder_cache[key] = mesh;
+		return mesh;
+	}
+
+	void RC_Cylinder::ReleaseCache()
+	{
+		std::lock_guard<std::mutex> lock(cylinder_cache_mutex);
 
-		PxDefaultMemoryInputData input(buf.getData(), buf.getSize());
-		return GetPhysics()->createConvexMesh(input);
+		for (std::map<CylinderKey, PxConvexMesh*>::iterator it = cylinder_cache.begin(); it != cylinder_cache.end(); it++)
+			it->second->release();
+		cylinder_cache.clear();
 	}
 
 
 	RC_Cylinder::RC_Cylinder(const PxTransform& pose, PxReal radius, PxReal halfHeight, PxReal density)
 		: DynamicActor(pose), m_radius(radius), m_halfHeight(halfHeight)
 	{
-		PxConvexMesh* mesh = RC_Cylinder::CreateConvexCylinder(radius, halfHeight);
+		PxConvexMesh* mesh = RC_Cylinder::ConvexCylinder(radius, halfHeight);
 		if (mesh) {
 			PxConvexMeshGeometry geom(mesh);
 			CreateShape(geom, density);
 		}
 	}
-
-	void RC_Cylinder::Render()
-	{
-		PxTransform pose = ((PxRigidBody*)Get())->getGlobalPose();
-		PxMat44 shapePose(pose);
-
-		glEnable(GL_COLOR_MATERIAL);    
-		glColorMaterial(GL_FRONT, GL_AMBIENT_AND_DIFFUSE);
-		glColor3f(0.6f, 0.34509803921568627f, 0.16470588235294117f);
-
-		glPushMatrix();
-		glMultMatrixf((float*)&shapePose);
-		glTranslatef(0.0f, m_halfHeight, 0.f);
-		glRotatef(90.0f, 1.0f, 0.0f, 0.0f);
-
-
-
-		// Cylinder body
-		GLUquadric* qobj = gluNewQuadric();
-		gluQuadricNormals(qobj, GLU_SMOOTH);
-		gluCylinder(qobj, m_radius, m_radius, m_halfHeight * 2.f, 64, 32);
-		gluDeleteQuadric(qobj);
-
-		glPopMatrix();
-	}
 }
\ No newline at end of file
@@ -3,7 +3,6 @@
 #include "PhysicsEngine.h"
 #include <iostream>
 #include <iomanip>
-#include "Extras/Renderer.h"
 #include <vector>
 
 
@@ -12,8 +11,16 @@ namespace PhysicsEngine {
 	public:
 		RC_Cylinder(const PxTransform& pose, PxReal radius, PxReal halfHeight, PxReal density);
 
-		void Render();
-		static PxConvexMesh* CreateConvexCylinder(PxReal radius, PxReal halfHeight, int slices = 16);
+		PxReal Radius() { return m_radius; }
+		PxReal HalfHeight() { return m_halfHeight; }
+		///Create a new convex cylinder (cooked or loaded from the mesh pack), taper - ratio of the top to the bottom radius
+		static PxConvexMesh* CreateConvexCylinder(PxReal radius, PxReal halfHeight, int slices = 16, PxReal taper = 1.f);
+
+		///Get a convex cylinder shared by all actors, it is cooked on the first request only (thread-safe)
+		static PxConvexMesh* ConvexCylinder(PxReal radius, PxReal halfHeight, int slices = 16, PxReal taper = 1.f);
+
+		///Drop the references held by the cylinder cache (shapes keep their own)
+		static void ReleaseCache();
 
 	private:
 		PxReal m_radius;
@@ -24,7 +31,7 @@ namespace PhysicsEngine {
 	inline PxConvexMeshGeometry CylinderGeometry(PxReal rad, PxReal halfHeight)
 	{
 		int slices = 20;
-		PxConvexMesh* mesh = RC_Cylinder::CreateConvexCylinder(rad, halfHeight, slices);
+		PxConvexMesh* mesh = RC_Cylinder::ConvexCylinder(rad, halfHeight, slices);
 		PxConvexMeshGeometry geometry(mesh);
 		return geometry;
 	}
@@ -1,13 +1,110 @@
 #include <iostream>
+#include <cstdlib>
+#include <cstring>
 #include "VisualDebugger.h"
+#include "Benchmark.h"
 
 using namespace std;
 
-int main()
+void Usage()
 {
+	cerr << "Usage: Simulation [options]" << endl;
+	cerr << "    --threads N     - number of PhysX worker threads (0 - auto)" << endl;
+	cerr << "    --affinity MASK - pin worker threads to the cores in MASK (e.g. 0xF)" << endl;
+	cerr << "    --record FILE   - record the input commands (F1 stops and saves)" << endl;
+	cerr << "    --replay FILE   - replay the input commands recorded to FILE" << endl;
+	cerr << "    --bench threads   - print step times for 1/2/4/8/N worker threads and exit" << endl;
+	cerr << "    --bench shapes    - print actor construction times for 66 and 1000 shapes and exit" << endl;
+	cerr << "    --bench startup   - print the scene startup time with cooked and with packed meshes and exit" << endl;
+	cerr << "    --bench particles - print the step time of 100k cloud particles and of each backend at 500/5k/50k and exit" << endl;
+	cerr << "    --mesh-pack FILE - cooked mesh pack (default meshes.pack, \"\" - always cook)" << endl;
+	cerr << "    --particles rigid|cloud|physx - sawdust backend (default cloud)" << endl;
+	cerr << "    --renderer fixed|gl33 - shape renderer: fixed-function or OpenGL 3.3 (default fixed)" << endl;
+	cerr << "    --trace FILE    - write the profiling zones as a Chrome trace on exit (PROFILER builds)" << endl;
+}
+
+int main(int argc, char** argv)
+{
+	PhysicsEngine::SceneConfig config;
+	const char* bench = 0;
+	PhysicsEngine::ParticleBackend backend = PhysicsEngine::CLOUD_PARTICLES;
+	VisualDebugger::Renderer::RenderBackend renderer = VisualDebugger::Renderer::FIXED_FUNCTION_RENDERER;
+	const char* record = 0;
+	const char* replay = 0;
+	const char* trace = 0;
+
+	for (int i = 1; i < argc; i++)
+	{
+		if (!strcmp(argv[i], "--threads") && (i + 1 < argc))
+			config.threads = (physx::PxU32)strtoul(argv[++i], 0, 0);
+		else if (!strcmp(argv[i], "--affinity") && (i + 1 < argc))
+			config.affinity_mask = (physx::PxU32)strtoul(argv[++i], 0, 0);
+		else if (!strcmp(argv[i], "--record") && (i + 1 < argc))
+			record = argv[++i];
+		else if (!strcmp(argv[i], "--replay") && (i + 1 < argc))
+			replay = argv[++i];
+		else if (!strcmp(argv[i], "--trace") && (i + 1 < argc))
+			trace = argv[++i];
+		else if (!strcmp(argv[i], "--mesh-pack") && (i + 1 < argc))
+			PhysicsEngine::MeshPackFile(argv[++i]);
+		else if (!strcmp(argv[i], "--bench") && (i + 1 < argc))
+			bench = argv[++i];
+		else if (!strcmp(argv[i], "--particles") && (i + 1 < argc) && PhysicsEngine::ParticleBackendByName(argv[i + 1], backend))
+			i++;
+		else if (!strcmp(argv[i], "--renderer") && (i + 1 < argc) && VisualDebugger::Renderer::RenderBackendByName(argv[i + 1], renderer))
+			i++;
+		else
+		{
+			Usage();
+			return 1;
+		}
+	}
+
+	if (record && replay)
+	{
+		Usage();
+		return 1;
+	}
+
+	if (bench)
+	{
+		if (strcmp(bench, "threads") && strcmp(bench, "shapes") && strcmp(bench, "startup") && strcmp(bench, "particles"))
+		{
+			Usage();
+			return 1;
+		}
+
+		try
+		{
+			PhysicsEngine::PxInit();
+			if (!strcmp(bench, "shapes"))
+				Benchmark::Shapes();
+			else if (!strcmp(bench, "startup"))
+				Benchmark::Startup(config);
+			else if (!strcmp(bench, "particles"))
+			{
+				Benchmark::Particles();
+				Benchmark::ParticleBackends(config);
+			}
+			else
+				Benchmark::Threads();
+		}
+		catch (Exception* exc)
+		{
+			cerr << exc->what() << endl;
+			delete exc;
+			return 1;
+		}
+		PhysicsEngine::PxRelease();
+		return 0;
+	}
+
+	//F12 resets the scene in place
+	config.snapshot = true;
+
 	try 
 	{ 
-		VisualDebugger::Init("Simulation", 800, 800); 
+		VisualDebugger::Init("Simulation", 800, 800, config, renderer); 
 	}
 	catch (Exception exc) 
 	{ 
@@ -15,7 +112,17 @@ int main()
 		return 0; 
 	}
 
+	VisualDebugger::SawdustBackend(backend);
+
+	if (trace)
+		VisualDebugger::Trace(trace);
+
+	if (replay && !VisualDebugger::Replay(replay))
+		return 1;
+	else if (record)
+		VisualDebugger::Record(record);
+
 	VisualDebugger::Start();
 
 	return 0;
-}
\ No newline at end of file
+}
@@ -1,8 +1,12 @@
 #include "VisualDebugger.h"
 #include <vector>
+#include <chrono>
+#include <sstream>
+#include <iomanip>
 #include "Extras\Camera.h"
 #include "Extras\Renderer.h"
 #include "Extras\HUD.h"
+#include "Extras\FrameStats.h"
 
 namespace VisualDebugger
 {
@@ -19,7 +23,20 @@ namespace VisualDebugger
 	{
 		EMPTY = 0,
 		HELP = 1,
-		PAUSE = 2
+		PAUSE = 2,
+		PERF = 3
+	};
+
+	//stages timed in every frame for the performance screen
+	enum FrameStage
+	{
+		STAGE_FRAME,
+		STAGE_SIMULATE,
+		STAGE_FETCH,
+		STAGE_UPDATE,
+		STAGE_BREAK,
+		STAGE_RENDER,
+		STAGE_COUNT
 	};
 
 	//function declarations
@@ -34,35 +51,73 @@ namespace VisualDebugger
 
 	void RenderScene();
 	void ToggleRenderMode();
+	void TogglePipelined();
+	void ToggleRecording();
+	void SaveRecording();
 	void HUDInit();
+	void PerfSample(double render_time);
+	void PerfUpdate();
 
 	///simulation objects
 	Camera* camera;
 	PhysicsEngine::MyScene* scene;
 	PxReal delta_time = 1.f/90.f;
-	PxReal gForceStrength = 20;
+	std::chrono::steady_clock::time_point last_frame;
+	//frame time statistics of the current update mode
+	double frame_time = 0.;
+	PxU32 frame_count = 0;
+	double fetch_time_start = 0.;
+	//input log written by the recording (F1) and read by the replay (F2)
+	std::string input_file = "input.rec";
+	//Chrome trace written on exit (empty - not profiling)
+	std::string trace_file;
 	RenderMode render_mode = NORMAL;
 	const int MAX_KEYS = 256;
 	bool key_state[MAX_KEYS];
 	bool hud_show = true;
 	HUD hud;
+	//debug data is only generated for the shapes up to this distance in the view frustum
+	const PxReal debug_distance = 100.f;
+	//help screen lines with the culling and draw state statistics
+	unsigned int culling_line = 0;
+	unsigned int state_line = 0;
+	const PxReal hud_font_size = 0.018f;
+	//performance screen (F3): rolling stage timings, refreshed a few times per second
+	bool perf_show = false;
+	FrameStats perf_stats(STAGE_COUNT);
+	const double perf_refresh = 0.25;
+	double perf_elapsed = 0.;
+	//totals of the timed stages at the end of the last frame (in seconds)
+	double perf_totals[STAGE_COUNT] = {};
+	unsigned int perf_stage_line = 0;
+	unsigned int perf_stats_line = 0;
+	//frame times of the graph (in ms) and the scale of its frame
+	std::vector<float> perf_graph;
+	PxReal perf_graph_max = 1000.f / 30.f;
 
 	//Init the debugger
-	void Init(const char *window_name, int width, int height)
+	void Init(const char *window_name, int width, int height, const PhysicsEngine::SceneConfig& config, Renderer::RenderBackend backend)
 	{
 		///Init PhysX
 		PhysicsEngine::PxInit();
-		scene = new PhysicsEngine::MyScene();
+		scene = new PhysicsEngine::MyScene(config);
 		scene->Init();
+		//sleeping actors are drawn from the static batch
+		scene->SleepEvents(true);
+		//debug data is generated in the DEBUG and BOTH render modes only
+		scene->Visualisation(render_mode != NORMAL);
 
 		///Init renderer
 		Renderer::BackgroundColor(PxVec3(150.f/255.f,150.f/255.f,150.f/255.f));
 		Renderer::SetRenderDetail(40);
 		Renderer::InitWindow(window_name, width, height);
+		Renderer::Backend(backend);
 		Renderer::Init();
 
 		camera = new Camera(PxVec3(5.0f, 5.0f, -15.0f), PxVec3(0.f,-.1f,-1.f), 5.f);
 
+		last_frame = std::chrono::steady_clock::now();
+
 		//initialise HUD
 		HUDInit();
 
@@ -93,11 +148,16 @@ namespace VisualDebugger
 		hud.AddLine(EMPTY, "");
 		//add a help screen
 		hud.AddLine(HELP, " Simulation");
+		hud.AddLine(HELP, "    F1 - record input on/off");
+		hud.AddLine(HELP, "    F2 - replay recorded input");
 		hud.AddLine(HELP, "    F9 - select next actor");
 		hud.AddLine(HELP, "    F10 - pause");
+		hud.AddLine(HELP, "    F11 - pipelined update on/off");
 		hud.AddLine(HELP, "    F12 - reset");
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Display");
+		hud.AddLine(HELP, "    F3 - performance on/off");
+		hud.AddLine(HELP, "    F4 - frustum culling on/off");
 		hud.AddLine(HELP, "    F5 - help on/off");
 		hud.AddLine(HELP, "    F6 - shadows on/off");
 		hud.AddLine(HELP, "    F7 - render mode");
@@ -109,17 +169,74 @@ namespace VisualDebugger
 		hud.AddLine(HELP, "");
 		hud.AddLine(HELP, " Force (applied to the selected actor)");
 		hud.AddLine(HELP, "    I,K,J,L,U,M - forward,backward,left,right,up,down");
+		hud.AddLine(HELP, "");
+		culling_line = hud.Lines(HELP);
+		hud.AddLine(HELP, "");
+		state_line = hud.Lines(HELP);
+		hud.AddLine(HELP, "");
 		//add a pause screen
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "");
 		hud.AddLine(PAUSE, "   Simulation paused. Press F10 to continue.");
+		//add a performance screen, filled in by PerfUpdate
+		hud.AddLine(PERF, " Performance (ms/frame, average and max over the last frames)");
+		perf_stage_line = hud.Lines(PERF);
+		for (unsigned int i = 0; i < STAGE_COUNT; i++)
+			hud.AddLine(PERF, "");
+		hud.AddLine(PERF, "");
+		hud.AddLine(PERF, " PhysX statistics (last step)");
+		perf_stats_line = hud.Lines(PERF);
+		for (unsigned int i = 0; i < 4; i++)
+			hud.AddLine(PERF, "");
+		hud.AddLine(PERF, "");
+		hud.AddLine(PERF, "");
 		//set font size for all screens
-		hud.FontSize(0.018f);
+		hud.FontSize(hud_font_size);
 		//set font color for all screens
 		hud.Color(PxVec3(0.f,0.f,0.f));
 	}
 
+	void Record(const char* filename)
+	{
+		input_file = filename;
+		scene->StartRecording();
+	}
+
+	bool Replay(const char* filename)
+	{
+		input_file = filename;
+
+		PhysicsEngine::InputRecorder input;
+		if (!input.Load(input_file))
+		{
+			std::cerr << "Could not read the input log: " << input_file << std::endl;
+			return false;
+		}
+
+		std::cout << "Replaying " << input.Events().size() << " commands from " << input_file << std::endl;
+		scene->StartReplay(input);
+		return true;
+	}
+
+	bool Trace(const char* filename)
+	{
+		if (!Profiler::Available())
+		{
+			std::cerr << "Profiling zones are not compiled in (define PROFILER), no trace is written" << std::endl;
+			return false;
+		}
+
+		trace_file = filename;
+		Profiler::Start();
+		return true;
+	}
+
+	void SawdustBackend(PhysicsEngine::ParticleBackend backend)
+	{
+		scene->SawdustBackend(backend);
+	}
+
 	//Start the main loop
 	void Start()
 	{ 
@@ -129,12 +246,23 @@ namespace VisualDebugger
 	//Render the scene and perform a single simulation step
 	void RenderScene()
 	{
+		PROFILE_ZONE("VisualDebugger::RenderScene");
+
+		//finish the step left running in the last frame (pipelined mode)
+		scene->Sync();
+
 		//handle pressed keys
 		KeyHold();
 
+		//the statistics of the last step can only be read while no step is running
+		if (hud_show && perf_show && !scene->Pause() && (perf_elapsed >= perf_refresh))
+			PerfUpdate();
+
 		//start rendering
+		std::chrono::steady_clock::time_point render_start = std::chrono::steady_clock::now();
 		Renderer::Start(camera->getEye(), camera->getDir());
 
+		//debug data, cloth and PhysX particles cannot be read while the simulation is running
 		if ((render_mode == DEBUG) || (render_mode == BOTH))
 		{
 			Renderer::Render(scene->Get()->getRenderBuffer());
@@ -143,32 +271,153 @@ namespace VisualDebugger
 		if ((render_mode == NORMAL) || (render_mode == BOTH))
 		{
 			std::vector<PxActor*> actors = scene->GetAllActors();
-			if (actors.size())
-				Renderer::Render(&actors[0], (PxU32)actors.size());
+			std::vector<PxActor*> cloths;
+			for (PxU32 i = 0; i < actors.size(); i++)
+				if (actors[i]->getType() == PxActorType::eCLOTH)
+					cloths.push_back(actors[i]);
+			if (cloths.size())
+				Renderer::Render(&cloths[0], (PxU32)cloths.size());
+
+			PxParticleSystem* sawdust_particles = scene->SawdustParticleSystem();
+			if (sawdust_particles)
+				Renderer::RenderParticles(sawdust_particles, PxVec3(0.6f, 0.4f, 0.2f), 4.f);
+		}
+
+		//the next steps generate debug data for the shapes the camera can see
+		if (render_mode != NORMAL)
+			scene->Get()->setVisualizationCullingBox(Renderer::FrustumBounds(debug_distance));
+
+		//advance the simulation by the wall-clock time of the last frame in fixed steps,
+		//in the pipelined mode the last step keeps running while the rest of the frame is rendered
+		std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+		PxReal frame_dt = std::chrono::duration<PxReal>(now - last_frame).count();
+		scene->Advance(frame_dt);
+		last_frame = now;
+		//the simulation is timed by the scene, not as part of the rendering
+		double advance_time = std::chrono::duration<double>(std::chrono::steady_clock::now() - now).count();
+		perf_stats.Set(STAGE_FRAME, frame_dt);
+		perf_elapsed += frame_dt;
+
+		frame_time += frame_dt;
+		frame_count++;
+
+		//hand the sleep state changes of the steps taken (or fetched by Sync) to the static batch
+		const std::vector<PxActor*>& woken = scene->WokenActors();
+		const std::vector<PxActor*>& slept = scene->SleptActors();
+		if (woken.size())
+			Renderer::Wake(&woken[0], (PxU32)woken.size());
+		if (slept.size())
+			Renderer::Sleep(&slept[0], (PxU32)slept.size());
+		scene->ClearSleepEvents();
+
+		if ((render_mode == NORMAL) || (render_mode == BOTH))
+		{
+			std::vector<PxActor*> actors = scene->GetAllActors();
+			std::vector<PxActor*> rigid_actors;
+			std::vector<PxTransform> poses;
+			for (PxU32 i = 0; i < actors.size(); i++)
+			{
+				if (actors[i]->getType() != PxActorType::eCLOTH)
+				{
+					rigid_actors.push_back(actors[i]);
+					//blend rigid actor poses between the last two steps
+					poses.push_back(scene->InterpolatedPose(actors[i]));
+				}
+			}
+			if (rigid_actors.size())
+				Renderer::Render(&rigid_actors[0], (PxU32)rigid_actors.size(), &poses[0]);
+
+			//sawdust particles simulated outside of PhysX
+			PhysicsEngine::ParticleCloud* sawdust = scene->Sawdust();
+			if (sawdust && sawdust->Count())
+				Renderer::RenderPoints(&sawdust->Positions()[0], sawdust->Count(), PxVec3(0.6f, 0.4f, 0.2f), 4.f);
 		}
 
+		for (auto log : scene->logs) {
+			Renderer::RenderCylinder(scene->InterpolatedPose(log->Get()), log->Radius(), log->HalfHeight(), *log->Color());
+		}
+		Renderer::FlushShapes();
+
 		//adjust the HUD state
 		if (hud_show)
 		{
 			if (scene->Pause())
 				hud.ActiveScreen(PAUSE);
+			else if (perf_show)
+				hud.ActiveScreen(PERF);
 			else
+			{
 				hud.ActiveScreen(HELP);
+				hud.SetLine(HELP, culling_line, " Shapes: " + std::to_string(Renderer::VisibleShapes()) + " visible, " +
+					std::to_string(Renderer::CulledShapes()) + " culled, " + std::to_string(Renderer::BatchedShapes()) + " batched" + (Renderer::FrustumCulling() ? "" : " (culling off)"));
+				hud.SetLine(HELP, state_line, " State changes: " + std::to_string(Renderer::StateChanges()));
+			}
 		}
 		else
 			hud.ActiveScreen(EMPTY);
 
 		//render HUD
 		hud.Render();
-		for (auto log : scene->logs) {
-			log->Render();
+
+		//frame time graph under the performance screen
+		if (hud.ActiveScreen() == PERF)
+		{
+			const PxVec2 graph_size(0.3f, 0.12f);
+			PxVec2 graph_location(0.01f, 1.f - (hud.Lines(PERF) + 0.5f) * hud_font_size - graph_size.y);
+			if (perf_graph.size())
+				Renderer::RenderGraph(&perf_graph[0], (PxU32)perf_graph.size(), perf_graph_max, graph_location, graph_size, PxVec3(0.f, 0.f, 0.f));
 		}
 
+		PerfSample(std::chrono::duration<double>(std::chrono::steady_clock::now() - render_start).count() - advance_time);
+
 		//finish rendering
-		Renderer::Finish();
+		{
+			PROFILE_ZONE("Renderer::Finish");
+			Renderer::Finish();
+		}
+	}
 
-		//perform a single simulation step
-		scene->Update(delta_time);
+	//close the timings of the current frame, the stages timed by the scene are read from its totals
+	void PerfSample(double render_time)
+	{
+		double totals[STAGE_COUNT] = { 0., scene->SimulateTime(), scene->FetchTime(), scene->UpdateTime(), scene->BreakTime(), 0. };
+		for (unsigned int i = STAGE_SIMULATE; i <= STAGE_BREAK; i++)
+		{
+			perf_stats.Set(i, totals[i] - perf_totals[i]);
+			perf_totals[i] = totals[i];
+		}
+		perf_stats.Set(STAGE_RENDER, render_time);
+		perf_stats.NextFrame();
+	}
+
+	//refresh the performance screen and the graph (called at a fixed rate, no step may be running)
+	void PerfUpdate()
+	{
+		perf_elapsed = 0.;
+
+		const char* names[STAGE_COUNT] = { "frame", "simulate", "fetchResults", "CustomUpdate", "  BreakHouse", "rendering" };
+		for (unsigned int i = 0; i < STAGE_COUNT; i++)
+		{
+			std::ostringstream line;
+			line << "    " << names[i] << ": " << std::fixed << std::setprecision(2)
+				<< 1000. * perf_stats.Average(i) << ", " << 1000. * perf_stats.Max(i);
+			hud.SetLine(PERF, perf_stage_line + i, line.str());
+		}
+
+		PxSimulationStatistics stats;
+		scene->Get()->getSimulationStatistics(stats);
+		hud.SetLine(PERF, perf_stats_line, "    active bodies: " + std::to_string(stats.nbActiveDynamicBodies) + " of " + std::to_string(stats.nbDynamicBodies));
+		hud.SetLine(PERF, perf_stats_line + 1, "    contact pairs: " + std::to_string(stats.nbDiscreteContactPairsTotal) +
+			" (" + std::to_string(stats.nbDiscreteContactPairsWithContacts) + " touching)");
+		hud.SetLine(PERF, perf_stats_line + 2, "    broadphase pairs: " + std::to_string(stats.nbNewPairs) + " new, " + std::to_string(stats.nbLostPairs) + " lost");
+		hud.SetLine(PERF, perf_stats_line + 3, "    constraints: " + std::to_string(stats.nbActiveConstraints));
+
+		//the graph is scaled to 30 fps unless a frame took longer
+		perf_stats.History(STAGE_FRAME, perf_graph);
+		perf_graph_max = 1000.f / 30.f;
+		for (PxU32 i = 0; i < perf_graph.size(); i++)
+			perf_graph_max = PxMax(perf_graph_max, perf_graph[i]);
+		hud.SetLine(PERF, perf_stats_line + 5, " Frame time (0-" + std::to_string((int)(perf_graph_max + 0.5f)) + " ms)");
 	}
 
 	//user defined keyboard handlers
@@ -233,29 +482,26 @@ namespace VisualDebugger
 	//handle force control keys
 	void ForceInput(int key)
 	{
-		if (!scene->GetSelectedActor())
-			return;
-
 		switch (toupper(key))
 		{
 			// Force controls on the selected actor
 		case 'I': //forward
-			scene->GetSelectedActor()->addForce(PxVec3(0,0,-1)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_FORWARD);
 			break;
 		case 'K': //backward
-			scene->GetSelectedActor()->addForce(PxVec3(0,0,1)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_BACKWARD);
 			break;
 		case 'J': //left
-			scene->GetSelectedActor()->addForce(PxVec3(-1,0,0)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_LEFT);
 			break;
 		case 'L': //right
-			scene->GetSelectedActor()->addForce(PxVec3(1,0,0)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_RIGHT);
 			break;
 		case 'U': //up
-			scene->GetSelectedActor()->addForce(PxVec3(0,10,0)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_UP);
 			break;
 		case 'M': //down
-			scene->GetSelectedActor()->addForce(PxVec3(0,-1,0)*gForceStrength);
+			scene->Execute(PhysicsEngine::FORCE_DOWN);
 			break;
 		default:
 			break;
@@ -265,10 +511,34 @@ namespace VisualDebugger
 	///handle special keys
 	void KeySpecial(int key, int x, int y)
 	{
+		//the scene cannot be modified while a step is running
+		scene->Sync();
+
 		//simulation control
 		switch (key)
 		{
+			//input recording
+		case GLUT_KEY_F1:
+			//record on/off
+			ToggleRecording();
+			break;
+		case GLUT_KEY_F2:
+			//replay the last recording
+			if (scene->Recording())
+				SaveRecording();
+			Replay(input_file.c_str());
+			break;
+
 			//display control
+		case GLUT_KEY_F3:
+			//performance screen on/off
+			perf_show = !perf_show;
+			perf_elapsed = perf_refresh;
+			break;
+		case GLUT_KEY_F4:
+			//frustum culling on/off
+			Renderer::FrustumCulling(!Renderer::FrustumCulling());
+			break;
 		case GLUT_KEY_F5:
 			//hud on/off
 			hud_show = !hud_show;
@@ -289,27 +559,31 @@ namespace VisualDebugger
 			//simulation control
 		case GLUT_KEY_F9:
 			//select next actor
-			scene->SelectNextActor();
+			scene->Execute(PhysicsEngine::SELECT_NEXT);
 			break;
 		case GLUT_KEY_F10:
 			//toggle scene pause
 			scene->Pause(!scene->Pause());
 			break;
+		case GLUT_KEY_F11:
+			//toggle pipelined update
+			TogglePipelined();
+			break;
 		case GLUT_KEY_F12:
 			//resect scene
 			scene->Reset();
 			break;
 		case GLUT_KEY_LEFT:
-			scene->MovePlayerLeft();
+			scene->Execute(PhysicsEngine::MOVE_LEFT);
 			break;
 		case GLUT_KEY_UP:
-			scene->MovePlayerUp();
+			scene->Execute(PhysicsEngine::MOVE_UP);
 			break;
 		case GLUT_KEY_RIGHT:    
-			scene->MovePlayerRight();
+			scene->Execute(PhysicsEngine::MOVE_RIGHT);
 			break;
 		case GLUT_KEY_DOWN:                 
-			scene->MovePlayerDown();
+			scene->Execute(PhysicsEngine::MOVE_DOWN);
 			break;
 		default:
 			break;
@@ -329,6 +603,7 @@ namespace VisualDebugger
 		if (key == 27)
 			exit(0);
 
+		scene->Sync();
 		UserKeyPress(key);
 	}
 
@@ -336,6 +611,7 @@ namespace VisualDebugger
 	void KeyRelease(unsigned char key, int x, int y)
 	{
 		key_state[key] = false;
+		scene->Sync();
 		UserKeyRelease(key);
 	}
 
@@ -382,11 +658,63 @@ namespace VisualDebugger
 			render_mode = BOTH;
 		else if (render_mode == BOTH)
 			render_mode = NORMAL;
+
+		scene->Visualisation(render_mode != NORMAL);
+	}
+
+	void TogglePipelined()
+	{
+		//report the average frame time of the mode being left
+		if (frame_count)
+		{
+			std::cout << (scene->Pipelined() ? "Pipelined" : "Blocking") << " update: "
+				<< 1000. * frame_time / frame_count << " ms/frame, "
+				<< 1000. * (scene->FetchTime() - fetch_time_start) / frame_count << " ms/frame waiting for results ("
+				<< frame_count << " frames)" << std::endl;
+		}
+
+		scene->Pipelined(!scene->Pipelined());
+
+		frame_time = 0.;
+		frame_count = 0;
+		fetch_time_start = scene->FetchTime();
+	}
+
+	void ToggleRecording()
+	{
+		if (scene->Recording())
+			SaveRecording();
+		else
+		{
+			std::cout << "Recording input to " << input_file << std::endl;
+			scene->StartRecording();
+		}
+	}
+
+	void SaveRecording()
+	{
+		const PhysicsEngine::InputRecorder& input = scene->StopRecording();
+		if (input.Save(input_file))
+			std::cout << "Recorded " << input.Events().size() << " commands to " << input_file << std::endl;
+		else
+			std::cerr << "Could not write the input log: " << input_file << std::endl;
 	}
 
 	///exit callback
 	void exitCallback(void)
 	{
+		if (scene->Recording())
+			SaveRecording();
+		if (!trace_file.empty())
+		{
+			//the step left running (pipelined mode) ends on the worker threads
+			scene->Sync();
+			Profiler::Stop();
+			if (Profiler::WriteChromeTrace(trace_file))
+				std::cout << "Trace written to " << trace_file << std::endl;
+			else
+				std::cerr << "Could not write the trace: " << trace_file << std::endl;
+		}
 		delete camera;
 		delete scene;
 		PhysicsEngine::PxRelease();
@@ -1,13 +1,28 @@
 #pragma once
 
 #include "MyPhysicsEngine.h"
+#include "Extras\Renderer.h"
 
 namespace VisualDebugger
 {
 	using namespace physx;
 
 	///Init visualisation
-	void Init(const char *window_name, int width=512, int height=512);
+	void Init(const char *window_name, int width=512, int height=512,
+		const PhysicsEngine::SceneConfig& config=PhysicsEngine::SceneConfig(),
+		Renderer::RenderBackend backend=Renderer::FIXED_FUNCTION_RENDERER);
+
+	///Reset the scene and record the input commands to the file (saved on F1 or exit)
+	void Record(const char* filename);
+
+	///Reset the scene and replay the input commands from the file
+	bool Replay(const char* filename);
+
+	///Record the profiling zones and write them as a Chrome trace to the file on exit (needs a PROFILER build)
+	bool Trace(const char* filename);
+
+	///Set how the sawdust is simulated
+	void SawdustBackend(PhysicsEngine::ParticleBackend backend);
 
 	///Start visualisation
 	void Start();